@@ -0,0 +1,164 @@
+#ifndef FUNCTION_PARSER_ARENA_HPP
+#define FUNCTION_PARSER_ARENA_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+#include "tree.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace az {
+    /**
+     * Expression node allocated from the arena of its ArenaExpression. Operands are plain pointers into
+     * the same arena, nodes are trivially destructible and never freed one by one.
+     */
+    struct ArenaNode {
+        Kind op;
+        const ArenaNode* lhs;
+        const ArenaNode* rhs;
+        double value;
+
+        [[nodiscard]] Kind kind() const { return op; }
+
+        [[nodiscard]] double evaluate(const double x) const {
+            switch (op) {
+                case Kind::Number:
+                    return value;
+                case Kind::X:
+                    return x;
+                case Kind::Variable:
+                    return value == 0.0 ? x : std::numeric_limits<double>::quiet_NaN();
+                default:
+                    return is_binary(op) ? az::apply(op, lhs->evaluate(x), rhs->evaluate(x))
+                                         : az::apply(op, lhs->evaluate(x));
+            }
+        }
+    };
+
+    [[nodiscard]] inline std::pair<const ArenaNode*, const ArenaNode*> children(const ArenaNode& n) {
+        return {n.lhs, n.rhs};
+    }
+
+    [[nodiscard]] inline double number_value(const ArenaNode& n) {
+        return n.value;
+    }
+
+    /**
+     * Variable nodes keep their slot in value.
+     */
+    [[nodiscard]] inline std::uint32_t variable_slot(const ArenaNode& n) {
+        return static_cast<std::uint32_t>(n.value);
+    }
+
+    /**
+     * Handle owning all nodes of one parsed expression. Destroying it releases the whole arena at once.
+     */
+    class ArenaExpression {
+    public:
+        ArenaExpression() = default;
+
+        ArenaExpression(std::unique_ptr<std::pmr::monotonic_buffer_resource> arena, const ArenaNode* root,
+                        const std::size_t size)
+            : arena_(std::move(arena)), root_(root), size_(size) {}
+
+        explicit operator bool() const { return root_ != nullptr; }
+
+        [[nodiscard]] double evaluate(const double x) const {
+            return root_->evaluate(x);
+        }
+
+        [[nodiscard]] const ArenaNode& root() const { return *root_; }
+
+        /**
+         * Number of nodes allocated for the expression.
+         */
+        [[nodiscard]] std::size_t size() const { return size_; }
+
+    private:
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+        const ArenaNode* root_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
+    namespace detail {
+        struct ArenaState {
+            std::pmr::memory_resource* resource;
+            mutable std::size_t nodes = 0;
+
+            const ArenaNode* make(const Kind op, const ArenaNode* l = nullptr, const ArenaNode* r = nullptr,
+                                  const double value = 0.0) const {
+                void* memory = resource->allocate(sizeof(ArenaNode), alignof(ArenaNode));
+                ++nodes;
+                return ::new(memory) ArenaNode{op, l, r, value};
+            }
+        };
+
+        /**
+         * Builds ArenaNode graph inside the arena passed to lexy as parse state.
+         */
+        struct arena_builder {
+            using node = const ArenaNode*;
+
+            static constexpr auto number = lexy::callback_with_state<node>([](const auto& state, const auto& lexeme) {
+                return state.make(Kind::Number, nullptr, nullptr, grammar::to_double(lexeme));
+            });
+
+            static constexpr auto x = lexy::callback_with_state<node>([](const auto& state) {
+                return state.make(Kind::X);
+            });
+
+            template<typename T>
+            static constexpr auto unary = lexy::callback_with_state<node>([](const auto& state, node p) {
+                return state.make(T::type, p);
+            });
+
+            template<typename Op, typename T>
+            static constexpr auto binary = [](const auto& state, node l, Op, node r) {
+                return state.make(T::type, l, r);
+            };
+
+            static constexpr auto expression = lexy::callback_with_state<node>(
+                [](const auto&, node e) { return e; },
+                [](const auto& state, lexy::op<grammar::op_minus>, node e) {
+                    return state.make(Kind::Negative, e);
+                },
+                binary<lexy::op<grammar::op_pow>, Pow>,
+                binary<lexy::op<grammar::op_mul>, Mul>,
+                binary<lexy::op<grammar::op_div>, Div>,
+                binary<lexy::op<grammar::op_plus>, Plus>,
+                binary<lexy::op<grammar::op_minus>, Minus>);
+        };
+    } // namespace az::detail
+
+    /**
+     * Parses expression into nodes allocated from a single monotonic arena owned by returned handle.
+     * Every node consumes at least one character, so the arena is sized up front from the input length
+     * and parsing usually allocates memory only once. If parsing fails, empty handle is returned.
+     */
+    inline ArenaExpression parse_arena(const std::string_view input) {
+        const std::size_t capacity = (input.size() + 1) * sizeof(ArenaNode);
+        auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>(capacity);
+        const detail::ArenaState state{arena.get()};
+
+        const auto exp = lexy::string_input(input.data(), input.size());
+        const auto result =
+                lexy::parse<grammar::basic_exp<detail::arena_builder>>(exp, state, lexy::noop);
+
+        if (!result.has_value() || result.is_error())
+            return {};
+        return {std::move(arena), result.value(), state.nodes};
+    }
+
+    inline Program compile(const ArenaExpression& expression) {
+        return detail::Compiler<ArenaNode>(expression.root())(expression.root());
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_ARENA_HPP
@@ -0,0 +1,170 @@
+#ifndef FUNCTION_PARSER_CACHE_HPP
+#define FUNCTION_PARSER_CACHE_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace az {
+    /**
+     * Removes whitespace which the grammar skips anyway. Whitespace between two characters that could
+     * belong to the same token (letters, digits, period) is collapsed into single space instead, so
+     * "1 2" and "s in(x)" do not become valid expressions.
+     */
+    inline std::string normalize_expression(const std::string_view input) {
+        const auto is_space = [](const char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        };
+        const auto is_word = [](const char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '.';
+        };
+
+        std::string result;
+        result.reserve(input.size());
+        bool pending_space = false;
+        for (const char c : input) {
+            if (is_space(c)) {
+                pending_space = true;
+                continue;
+            }
+            if (pending_space && !result.empty() && is_word(result.back()) && is_word(c)) {
+                result.push_back(' ');
+            }
+            pending_space = false;
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    struct CacheStatistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    /**
+     * Thread-safe cache of compiled expressions keyed by normalized expression text. Keys are spread over
+     * independently locked shards, each keeping its entries in LRU order and evicting the least recently
+     * used ones once its share of the memory budget is exceeded. Invalid expressions are not cached.
+     */
+    class ParseCache {
+    public:
+        explicit ParseCache(const std::size_t max_bytes = std::size_t{64} << 20, const std::size_t shards = 16)
+            : shards_(std::max<std::size_t>(shards, 1)) {
+            for (auto& shard: shards_) {
+                shard.budget = max_bytes / shards_.size();
+            }
+        }
+
+        /**
+         * Returns compiled expression, parsing it only if it is not cached yet. Returns nullptr if the
+         * expression is invalid.
+         */
+        std::shared_ptr<const Program> get(const std::string_view expression) {
+            std::string key = normalize_expression(expression);
+            Shard& shard = shards_[std::hash<std::string>{}(key) % shards_.size()];
+            {
+                const std::lock_guard lock(shard.mutex);
+                if (const auto it = shard.index.find(key); it != shard.index.end()) {
+                    ++shard.hits;
+                    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                    return it->second->program;
+                }
+                ++shard.misses;
+            }
+
+            // Parsing runs without the lock, so a slow parse does not block other lookups of the shard.
+            const auto tree = parse_expression(key);
+            if (!tree) {
+                return nullptr;
+            }
+            auto program = std::make_shared<const Program>(compile(*tree));
+            const std::size_t bytes = cost(key, *program);
+
+            const std::lock_guard lock(shard.mutex);
+            if (const auto it = shard.index.find(key); it != shard.index.end()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return it->second->program;
+            }
+            if (bytes > shard.budget) {
+                return program;
+            }
+            while (shard.bytes + bytes > shard.budget) {
+                const Entry& victim = shard.lru.back();
+                shard.bytes -= victim.bytes;
+                shard.index.erase(victim.key);
+                shard.lru.pop_back();
+                ++shard.evictions;
+            }
+            shard.lru.push_front({key, program, bytes});
+            shard.index.emplace(std::move(key), shard.lru.begin());
+            shard.bytes += bytes;
+            return program;
+        }
+
+        [[nodiscard]] CacheStatistics statistics() const {
+            CacheStatistics result;
+            for (const auto& shard: shards_) {
+                const std::lock_guard lock(shard.mutex);
+                result.hits += shard.hits;
+                result.misses += shard.misses;
+                result.evictions += shard.evictions;
+                result.entries += shard.index.size();
+                result.bytes += shard.bytes;
+            }
+            return result;
+        }
+
+        void clear() {
+            for (auto& shard: shards_) {
+                const std::lock_guard lock(shard.mutex);
+                shard.index.clear();
+                shard.lru.clear();
+                shard.bytes = 0;
+            }
+        }
+
+    private:
+        struct Entry {
+            std::string key;
+            std::shared_ptr<const Program> program;
+            std::size_t bytes;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::list<Entry> lru;
+            std::unordered_map<std::string, std::list<Entry>::iterator> index;
+            std::size_t budget = 0;
+            std::size_t bytes = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+        };
+
+        // Approximate memory held by one entry: the key is stored twice, once in the LRU list and once
+        // in the index.
+        static std::size_t cost(const std::string& key, const Program& program) {
+            return 2 * key.size() + sizeof(Entry) + sizeof(Program) + 64
+                   + program.instructions().size() * sizeof(Instruction);
+        }
+
+        std::vector<Shard> shards_;
+    };
+} // namespace az
+
+#endif //FUNCTION_PARSER_CACHE_HPP
@@ -0,0 +1,283 @@
+#ifndef FUNCTION_PARSER_CHEBYSHEV_HPP
+#define FUNCTION_PARSER_CHEBYSHEV_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace az {
+    struct ApproximationOptions {
+        /// Largest degree of the polynomial of one piece.
+        std::size_t max_degree = 64;
+        /// Largest number of pieces. Once reached, remaining pieces are not split further and error() grows.
+        std::size_t max_pieces = 1 << 16;
+        /// Width, relative to the whole range, below which pieces are not split to locate domain breaks and
+        /// poles. Piece containing one is then NaN.
+        double resolution = 1e-9;
+    };
+
+    /**
+     * Piecewise Chebyshev polynomial surrogate of a function on [lo, hi]. Piece i covers
+     * [breaks[i], breaks[i + 1]] and holds coefficients [offsets[i], offsets[i + 1]) of the series in
+     * T_j((2x - lo_i - hi_i) / (hi_i - lo_i)). Piece without coefficients is a gap where the function is
+     * NaN. Evaluation finds the piece by binary search and sums the series with Clenshaw's recurrence, so
+     * its cost does not depend on the expression it was built from.
+     */
+    class Approximation {
+    public:
+        Approximation(std::vector<double> breaks, std::vector<std::uint32_t> offsets, std::vector<double> coefficients,
+                      const double error)
+            : breaks_(std::move(breaks)), offsets_(std::move(offsets)), coefficients_(std::move(coefficients)),
+              error_(error) {
+            assert(breaks_.size() >= 2 && breaks_.size() == offsets_.size());
+            assert(offsets_.front() == 0 && offsets_.back() == coefficients_.size());
+        }
+
+        /**
+         * Value of the surrogate, NaN outside [lo(), hi()] and in gaps.
+         */
+        [[nodiscard]] double evaluate(const double x) const {
+            if (!(x >= breaks_.front() && x <= breaks_.back())) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            const auto piece = static_cast<std::size_t>(
+                std::upper_bound(breaks_.begin() + 1, breaks_.end() - 1, x) - breaks_.begin() - 1);
+            const std::uint32_t begin = offsets_[piece];
+            const std::uint32_t end = offsets_[piece + 1];
+            if (begin == end) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            const double lo = breaks_[piece];
+            const double hi = breaks_[piece + 1];
+            const double t = (2 * x - lo - hi) / (hi - lo);
+            double b1 = 0.0;
+            double b2 = 0.0;
+            for (std::uint32_t j = end - 1; j > begin; --j) {
+                const double b0 = 2 * t * b1 - b2 + coefficients_[j];
+                b2 = b1;
+                b1 = b0;
+            }
+            return coefficients_[begin] + t * b1 - b2;
+        }
+
+        void evaluate_batch(const std::span<const double> xs, const std::span<double> out) const {
+            assert(out.size() >= xs.size());
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                out[i] = evaluate(xs[i]);
+            }
+        }
+
+        /**
+         * Estimate of the largest error, relative to the largest magnitude of the function on a piece, found
+         * when the pieces were fitted: the larger of the error at points between interpolation nodes and
+         * the sum of dropped coefficients. It is not a guaranteed bound, the error between those points may be larger.
+         */
+        [[nodiscard]] double error() const { return error_; }
+
+        [[nodiscard]] double lo() const { return breaks_.front(); }
+
+        [[nodiscard]] double hi() const { return breaks_.back(); }
+
+        /**
+         * Number of pieces, including gaps.
+         */
+        [[nodiscard]] std::size_t size() const { return breaks_.size() - 1; }
+
+        [[nodiscard]] std::span<const double> breaks() const { return breaks_; }
+
+        [[nodiscard]] std::span<const std::uint32_t> offsets() const { return offsets_; }
+
+        [[nodiscard]] std::span<const double> coefficients() const { return coefficients_; }
+
+    private:
+        std::vector<double> breaks_;
+        std::vector<std::uint32_t> offsets_;
+        std::vector<double> coefficients_;
+        double error_;
+    };
+
+    namespace detail {
+        /**
+         * Fits pieces of one function. Values are computed by a compiled Program, all nodes of a fit in one
+         * batch.
+         */
+        class ChebyshevFitter {
+        public:
+            ChebyshevFitter(const Expression& function, const double tolerance, const ApproximationOptions& options)
+                : function_(function), program_(compile(function)), tolerance_(tolerance), options_(options) {}
+
+            Approximation fit(const double a, const double b) {
+                assert(a < b);
+                const double min_width = (b - a) * options_.resolution;
+                std::vector<std::pair<double, double>> stack{{a, b}};
+                breaks_ = {a};
+                offsets_ = {0};
+                while (!stack.empty()) {
+                    const auto [lo, hi] = stack.back();
+                    stack.pop_back();
+                    const bool last = hi - lo <= min_width || size() + stack.size() + 1 >= options_.max_pieces;
+                    if (!piece(lo, hi, last)) {
+                        const double mid = lo + (hi - lo) / 2;
+                        stack.emplace_back(mid, hi);
+                        stack.emplace_back(lo, mid);
+                    }
+                }
+                return {std::move(breaks_), std::move(offsets_), std::move(coefficients_), error_};
+            }
+
+        private:
+            [[nodiscard]] std::size_t size() const { return breaks_.size() - 1; }
+
+            /**
+             * Adds piece [lo, hi] if the function can be approximated on it, or if it must not be split. A
+             * piece where the function is NaN at every sample is a gap. So is a piece that must not be split
+             * but may contain a break or a pole.
+             */
+            bool piece(const double lo, const double hi, const bool last) {
+                const Interval range = function_.evaluate_interval({lo, hi});
+                if (range.domain == Domain::Outside) {
+                    add(hi, {}, 0.0);
+                    return true;
+                }
+                const bool bounded = range.domain == Domain::Inside && std::isfinite(range.lo)
+                                     && std::isfinite(range.hi);
+
+                std::vector<double> best;
+                double best_error = std::numeric_limits<double>::infinity();
+                for (std::size_t n = std::max<std::size_t>(1, std::min<std::size_t>(16, options_.max_degree)); ;
+                     n = std::min(2 * n, options_.max_degree)) {
+                    sample(lo, hi, n);
+                    const auto finite = std::count_if(ys_.begin(), ys_.end(),
+                                                      [](const double y) { return std::isfinite(y); });
+                    if (finite == 0) {
+                        add(hi, {}, 0.0);
+                        return true;
+                    }
+                    // Interval evaluation may also miss a NaN or infinity, e.g. after overflow.
+                    if (!bounded || static_cast<std::size_t>(finite) < ys_.size()) {
+                        if (last) {
+                            add(hi, {}, 0.0);
+                        }
+                        return last;
+                    }
+                    double error;
+                    std::vector<double> c = interpolate(lo, hi, n, error);
+                    if (error < best_error) {
+                        best = std::move(c);
+                        best_error = error;
+                    }
+                    if (best_error <= tolerance_ || n >= options_.max_degree) {
+                        break;
+                    }
+                }
+                if (best_error <= tolerance_ || last) {
+                    add(hi, best, best_error);
+                    return true;
+                }
+                return false;
+            }
+
+            void add(const double hi, const std::vector<double>& c, const double error) {
+                breaks_.push_back(hi);
+                coefficients_.insert(coefficients_.end(), c.begin(), c.end());
+                offsets_.push_back(static_cast<std::uint32_t>(coefficients_.size()));
+                error_ = std::max(error_, error);
+            }
+
+            /**
+             * Values of the function at n + 1 Chebyshev-Lobatto nodes of [lo, hi] followed by n points halfway
+             * between them, in one batch.
+             */
+            void sample(const double lo, const double hi, const std::size_t n) {
+                constexpr double pi = std::numbers::pi;
+                const double mid = lo + (hi - lo) / 2;
+                const double half = (hi - lo) / 2;
+                xs_.resize(2 * n + 1);
+                ys_.resize(xs_.size());
+                for (std::size_t k = 0; k <= n; ++k) {
+                    xs_[k] = mid + half * std::cos(pi * static_cast<double>(k) / static_cast<double>(n));
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    xs_[n + 1 + k] = mid + half * std::cos(pi * (static_cast<double>(k) + 0.5) / static_cast<double>(n));
+                }
+                program_.evaluate_batch(xs_, ys_);
+            }
+
+            /**
+             * Coefficients of the polynomial of degree n interpolating finite samples of [lo, hi] at the
+             * nodes, without trailing ones that do not matter for the tolerance. error is set to the relative
+             * error at the points between the nodes.
+             */
+            std::vector<double> interpolate(const double lo, const double hi, const std::size_t n, double& error) const {
+                constexpr double pi = std::numbers::pi;
+                double scale = 0.0;
+                for (const double y : ys_) {
+                    scale = std::max(scale, std::abs(y));
+                }
+                scale = scale > 0 ? scale : 1.0;
+
+                std::vector<double> c(n + 1);
+                for (std::size_t j = 0; j <= n; ++j) {
+                    double sum = 0.0;
+                    for (std::size_t k = 0; k <= n; ++k) {
+                        const double term = ys_[k] * std::cos(pi * static_cast<double>(j * k % (2 * n)) / static_cast<double>(n));
+                        sum += k == 0 || k == n ? term / 2 : term;
+                    }
+                    c[j] = sum * 2 / static_cast<double>(n);
+                }
+                c[0] /= 2;
+                c[n] /= 2;
+
+                // Coefficients of smooth functions decay, the tail dropped adds at most its sum to the error.
+                double dropped = 0.0;
+                while (c.size() > 1 && dropped + std::abs(c.back()) <= tolerance_ * scale / 4) {
+                    dropped += std::abs(c.back());
+                    c.pop_back();
+                }
+
+                const Approximation polynomial({lo, hi}, {0, static_cast<std::uint32_t>(c.size())}, c, 0.0);
+                double worst = dropped;
+                for (std::size_t k = n + 1; k < xs_.size(); ++k) {
+                    worst = std::max(worst, std::abs(polynomial.evaluate(xs_[k]) - ys_[k]));
+                }
+                error = worst / scale;
+                return c;
+            }
+
+            const Expression& function_;
+            const Program program_;
+            const double tolerance_;
+            const ApproximationOptions& options_;
+            std::vector<double> breaks_;
+            std::vector<std::uint32_t> offsets_;
+            std::vector<double> coefficients_;
+            double error_ = 0.0;
+            std::vector<double> xs_;
+            std::vector<double> ys_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Fits piecewise Chebyshev polynomials to function of x on [a, b] so that the error relative to the
+     * largest magnitude of the function on each piece stays within tolerance. Pieces start at degree 16,
+     * the degree is doubled up to max_degree and pieces that still miss the tolerance are halved. Where
+     * interval evaluation finds a possible domain break or pole, pieces are halved down to resolution and
+     * the piece containing it is left as a NaN gap. error() of the result estimates the error achieved.
+     */
+    [[nodiscard]] inline Approximation approximate(const Expression& function, const double a, const double b,
+                                                   const double tolerance, const ApproximationOptions& options = {}) {
+        return detail::ChebyshevFitter(function, tolerance, options).fit(a, b);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_CHEBYSHEV_HPP
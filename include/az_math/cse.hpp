@@ -0,0 +1,102 @@
+#ifndef FUNCTION_PARSER_CSE_HPP
+#define FUNCTION_PARSER_CSE_HPP
+
+#include "function_parser.hpp"
+#include "tree.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+namespace az {
+    namespace detail {
+        /**
+         * Identity of a node whose operands are already unique: equal keys mean structurally equal subtrees.
+         */
+        struct NodeKey {
+            Kind kind;
+            const Expression* lhs;
+            const Expression* rhs;
+            std::uint64_t value;
+
+            bool operator==(const NodeKey&) const = default;
+        };
+
+        struct NodeKeyHash {
+            std::size_t operator()(const NodeKey& k) const {
+                std::size_t h = std::hash<std::uint64_t>{}(k.value);
+                h = h * 31 + static_cast<std::size_t>(k.kind);
+                h = h * 31 + std::hash<const Expression*>{}(k.lhs);
+                h = h * 31 + std::hash<const Expression*>{}(k.rhs);
+                return h;
+            }
+        };
+
+        /**
+         * Hash-conses nodes bottom-up. Every structurally distinct subtree is kept only once, every other
+         * copy is replaced by a reference to it.
+         */
+        class HashConser {
+        public:
+            std::shared_ptr<Expression> operator()(const std::shared_ptr<Expression>& e) {
+                if (const auto it = done_.find(e.get()); it != done_.end()) {
+                    return it->second;
+                }
+
+                NodeKey key{e->kind(), nullptr, nullptr, 0};
+                std::shared_ptr<Expression> l;
+                std::shared_ptr<Expression> r;
+                if (is_binary(key.kind)) {
+                    const auto& b = static_cast<const BinaryExpression&>(*e);
+                    l = (*this)(b.lhs);
+                    r = (*this)(b.rhs);
+                } else if (is_unary(key.kind)) {
+                    l = (*this)(static_cast<const UnaryExpression&>(*e).prod);
+                } else if (key.kind == Kind::Number) {
+                    key.value = std::bit_cast<std::uint64_t>(number_value(*e));
+                } else if (key.kind == Kind::Variable) {
+                    key.value = variable_slot(*e);
+                }
+                key.lhs = l.get();
+                key.rhs = r.get();
+
+                auto& unique = unique_[key];
+                if (!unique) {
+                    if (is_binary(key.kind)) {
+                        const auto& b = static_cast<const BinaryExpression&>(*e);
+                        unique = l == b.lhs && r == b.rhs ? e : make_binary(key.kind, l, r);
+                    } else if (is_unary(key.kind)) {
+                        unique = l == static_cast<const UnaryExpression&>(*e).prod ? e : make_unary(key.kind, l);
+                    } else {
+                        unique = e;
+                    }
+                }
+                done_.emplace(e.get(), unique);
+                return unique;
+            }
+
+        private:
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>> done_;
+            std::unordered_map<NodeKey, std::shared_ptr<Expression>, NodeKeyHash> unique_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Merges structurally identical subtrees, turning the tree into a DAG where each distinct subexpression
+     * exists once. Compiled Program computes every shared node only once per evaluation, so
+     * (x+1)*(x+1)/(x+1) evaluates x+1 a single time. Running simplify first lets operands that differ only
+     * by order, like sin(x)*2 and 2*sin(x), be merged as well.
+     */
+    inline Optimized eliminate_common_subexpressions(const std::shared_ptr<Expression>& expression) {
+        Optimized result;
+        result.nodes_before = count_nodes(*expression);
+        result.expression = detail::HashConser()(expression);
+        result.nodes_after = count_nodes(*result.expression);
+        return result;
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_CSE_HPP
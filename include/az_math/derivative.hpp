@@ -0,0 +1,295 @@
+#ifndef FUNCTION_PARSER_DERIVATIVE_HPP
+#define FUNCTION_PARSER_DERIVATIVE_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+#include "simplify.hpp"
+#include "tree.hpp"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace az {
+    namespace detail {
+        /**
+         * Applies derivative rules node by node. Terms multiplied by a derivative that is exactly zero are
+         * dropped while building, so derivatives of constant factors do not grow the tree.
+         */
+        class Differentiator {
+        public:
+            using Node = std::shared_ptr<Expression>;
+
+            explicit Differentiator(const std::uint32_t slot) : slot_(slot) {}
+
+            Node operator()(const Expression& e) {
+                if (const auto it = done_.find(&e); it != done_.end()) {
+                    return it->second;
+                }
+                Node result = rule(e);
+                done_.emplace(&e, result);
+                return result;
+            }
+
+        private:
+            static Node number(const double value) {
+                return std::make_shared<Number>(value);
+            }
+
+            static bool is_zero(const Node& e) {
+                return e->kind() == Kind::Number && number_value(*e) == 0.0;
+            }
+
+            static bool is_one(const Node& e) {
+                return e->kind() == Kind::Number && number_value(*e) == 1.0;
+            }
+
+            static Node mul(Node l, Node r) {
+                if (is_zero(l) || is_zero(r)) return number(0.0);
+                if (is_one(l)) return r;
+                if (is_one(r)) return l;
+                return std::make_shared<Mul>(std::move(l), std::move(r));
+            }
+
+            static Node div(Node l, Node r) {
+                if (is_zero(l)) return number(0.0);
+                return std::make_shared<Div>(std::move(l), std::move(r));
+            }
+
+            static Node plus(Node l, Node r) {
+                if (is_zero(l)) return r;
+                if (is_zero(r)) return l;
+                return std::make_shared<Plus>(std::move(l), std::move(r));
+            }
+
+            static Node minus(Node l, Node r) {
+                if (is_zero(r)) return l;
+                if (is_zero(l)) return negative(std::move(r));
+                return std::make_shared<Minus>(std::move(l), std::move(r));
+            }
+
+            static Node negative(Node e) {
+                if (is_zero(e)) return e;
+                return std::make_shared<Negative>(std::move(e));
+            }
+
+            static Node square(Node e) {
+                return std::make_shared<Pow>(std::move(e), number(2.0));
+            }
+
+            // 1/e as e^-1: Div is NaN for divisors within domain_epsilon of zero, which would cut out of the
+            // derivative points where the function is defined, e.g. around x = 0 for sqrt(x).
+            static Node reciprocal(Node e) {
+                return std::make_shared<Pow>(std::move(e), number(-1.0));
+            }
+
+            // d where f is defined, NaN elsewhere: f*0 is 0 or NaN.
+            static Node defined_with(Node d, Node f) {
+                return std::make_shared<Plus>(std::move(d), std::make_shared<Mul>(std::move(f), number(0.0)));
+            }
+
+            Node rule(const Expression& e) {
+                if (e.kind() == Kind::Number) {
+                    return number(0.0);
+                }
+                if (e.kind() == Kind::X) {
+                    return number(slot_ == 0 ? 1.0 : 0.0);
+                }
+                if (e.kind() == Kind::Variable) {
+                    return number(variable_slot(e) == slot_ ? 1.0 : 0.0);
+                }
+                if (is_unary(e.kind())) {
+                    const Node& u = static_cast<const UnaryExpression&>(e).prod;
+                    Node du = (*this)(*u);
+                    if (is_zero(du)) {
+                        return du;
+                    }
+                    return unary(e.kind(), u, std::move(du));
+                }
+
+                const auto& b = static_cast<const BinaryExpression&>(e);
+                const Node& u = b.lhs;
+                const Node& v = b.rhs;
+                Node du = (*this)(*u);
+                Node dv = (*this)(*v);
+                switch (e.kind()) {
+                    case Kind::Plus:
+                        return plus(du, dv);
+                    case Kind::Minus:
+                        return minus(du, dv);
+                    case Kind::Mul:
+                        return plus(mul(du, v), mul(u, dv));
+                    case Kind::Div:
+                        // (u' - u/v * v') / v divides by v itself, so it is defined where u/v is.
+                        return div(minus(du, mul(div(u, v), dv)), v);
+                    case Kind::Pow:
+                        if (is_zero(dv)) {
+                            // (u^c)' = c * u^(c-1) * u'
+                            const Node exponent = std::make_shared<Minus>(v, number(1.0));
+                            return mul(mul(v, std::make_shared<Pow>(u, exponent)), du);
+                        }
+                        // (u^v)' = u^v * (v' * ln(u) + v * u' / u)
+                        return mul(std::make_shared<Pow>(u, v),
+                                   plus(mul(dv, std::make_shared<Ln>(u)), mul(mul(v, du), reciprocal(u))));
+                    default:
+                        return number(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+
+            static Node unary(const Kind kind, const Node& u, Node du) {
+                switch (kind) {
+                    case Kind::Sin:
+                        return mul(std::make_shared<Cos>(u), du);
+                    case Kind::Cos:
+                        return negative(mul(std::make_shared<Sin>(u), du));
+                    case Kind::Tan:
+                        // 1 + tan^2 and 1 + cot^2 are defined exactly where tan and cot are.
+                        return mul(plus(number(1.0), square(std::make_shared<Tan>(u))), du);
+                    case Kind::Cot:
+                        return negative(mul(plus(number(1.0), square(std::make_shared<Cot>(u))), du));
+                    case Kind::Sqrt:
+                        return mul(du, reciprocal(mul(number(2.0), std::make_shared<Sqrt>(u))));
+                    case Kind::Cbrt:
+                        return mul(du, reciprocal(mul(number(3.0), square(std::make_shared<Cbrt>(u)))));
+                    case Kind::Ln:
+                        return defined_with(mul(du, reciprocal(u)), std::make_shared<Ln>(u));
+                    case Kind::Lg:
+                        return defined_with(mul(du, reciprocal(mul(u, number(std::numbers::ln2)))),
+                                            std::make_shared<Lg>(u));
+                    case Kind::Log:
+                        return defined_with(mul(du, reciprocal(mul(u, number(std::numbers::ln10)))),
+                                            std::make_shared<Log>(u));
+                    case Kind::Arcsin:
+                        return mul(du, reciprocal(std::make_shared<Sqrt>(minus(number(1.0), square(u)))));
+                    case Kind::Arccos:
+                        return negative(mul(du, reciprocal(std::make_shared<Sqrt>(minus(number(1.0), square(u))))));
+                    case Kind::Arctan:
+                        return div(du, plus(number(1.0), square(u)));
+                    case Kind::Negative:
+                        return negative(du);
+                    default:
+                        return number(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+
+            std::uint32_t slot_;
+            std::unordered_map<const Expression*, Node> done_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Returns simplified derivative of expression with respect to the variable in slot, x by default.
+     * Rules keep the domain of every function and quotient they differentiate, so the derivative is NaN
+     * where evaluate_with_derivative gives NaN. Terms multiplied by a derivative that is exactly zero are
+     * dropped though, so the result may be defined at points where the expression itself is not, e.g.
+     * (ln(x)*0)' = 0.
+     */
+    inline std::shared_ptr<Expression> differentiate(const Expression& expression, const std::uint32_t slot = 0) {
+        return simplify(detail::Differentiator(slot)(expression)).expression;
+    }
+
+    /**
+     * Value of a function together with its derivative.
+     */
+    struct Dual {
+        double value;
+        double derivative;
+    };
+
+    namespace detail {
+        inline Dual derive(const Kind kind, const Dual a) {
+            constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+            const double v = apply(kind, a.value);
+            if (std::isnan(v)) {
+                return {v, nan};
+            }
+            const double t = a.value;
+            const double d = a.derivative;
+            switch (kind) {
+                case Kind::Sin: return {v, std::cos(t) * d};
+                case Kind::Cos: return {v, -std::sin(t) * d};
+                case Kind::Tan: return {v, d / (std::cos(t) * std::cos(t))};
+                case Kind::Cot: return {v, -d / (std::sin(t) * std::sin(t))};
+                case Kind::Sqrt: return {v, d / (2 * v)};
+                case Kind::Cbrt: return {v, d / (3 * v * v)};
+                case Kind::Ln: return {v, d / t};
+                case Kind::Lg: return {v, d / (t * std::numbers::ln2)};
+                case Kind::Log: return {v, d / (t * std::numbers::ln10)};
+                case Kind::Arcsin: return {v, d / std::sqrt(1 - t * t)};
+                case Kind::Arccos: return {v, -d / std::sqrt(1 - t * t)};
+                case Kind::Arctan: return {v, d / (1 + t * t)};
+                case Kind::Negative: return {v, -d};
+                default: return {nan, nan};
+            }
+        }
+
+        inline Dual derive(const Kind kind, const Dual a, const Dual b) {
+            constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+            const double v = apply(kind, a.value, b.value);
+            if (std::isnan(v)) {
+                return {v, nan};
+            }
+            switch (kind) {
+                case Kind::Plus: return {v, a.derivative + b.derivative};
+                case Kind::Minus: return {v, a.derivative - b.derivative};
+                case Kind::Mul: return {v, a.derivative * b.value + a.value * b.derivative};
+                case Kind::Div:
+                    return {v, (a.derivative * b.value - a.value * b.derivative) / (b.value * b.value)};
+                case Kind::Pow: {
+                    // The ln(a) term is skipped for constant exponents, so negative bases keep working.
+                    double d = a.derivative == 0.0 ? 0.0 : b.value * std::pow(a.value, b.value - 1) * a.derivative;
+                    if (b.derivative != 0.0) {
+                        d += v * std::log(a.value) * b.derivative;
+                    }
+                    return {v, d};
+                }
+                default: return {nan, nan};
+            }
+        }
+
+        inline Dual run_dual(const std::span<const Instruction> code, Dual* r, const double* variables,
+                             const std::uint32_t slot) {
+            for (const Instruction& i : code) {
+                switch (i.op) {
+                    case Kind::Number: r[i.dst] = {i.value, 0.0}; break;
+                    case Kind::X: r[i.dst] = {variables[0], slot == 0 ? 1.0 : 0.0}; break;
+                    case Kind::Variable: r[i.dst] = {variables[i.lhs], slot == i.lhs ? 1.0 : 0.0}; break;
+                    default:
+                        r[i.dst] = is_binary(i.op) ? derive(i.op, r[i.lhs], r[i.rhs]) : derive(i.op, r[i.lhs]);
+                        break;
+                }
+            }
+            return r[code.back().dst];
+        }
+    } // namespace az::detail
+
+    /**
+     * Evaluates function and its partial derivative with respect to the variable in slot in one pass using
+     * forward-mode dual numbers. Value is the same as Program::evaluate gives; derivative is NaN wherever
+     * the value is.
+     */
+    inline Dual evaluate_with_derivative(const Program& program, const std::span<const double> variables,
+                                         const std::uint32_t slot) {
+        assert(variables.size() >= program.variables());
+        if (program.registers() <= Program::inline_registers) {
+            std::array<Dual, Program::inline_registers> r;
+            return detail::run_dual(program.instructions(), r.data(), variables.data(), slot);
+        }
+        std::vector<Dual> r(program.registers());
+        return detail::run_dual(program.instructions(), r.data(), variables.data(), slot);
+    }
+
+    inline Dual evaluate_with_derivative(const Program& program, const double x) {
+        assert(program.variables() <= 1);
+        return evaluate_with_derivative(program, std::span<const double>(&x, 1), 0);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_DERIVATIVE_HPP
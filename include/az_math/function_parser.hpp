@@ -7,317 +7,1197 @@
 #include <lexy/action/parse.hpp>
 #include <lexy/input/string_input.hpp>
 
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
 #include <memory>
+#include <numbers>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
+#include <vector>
 
 namespace az {
+    enum class Kind : std::uint8_t {
+        Number,
+        X,
+        Variable,
+        Sin,
+        Cos,
+        Tan,
+        Cot,
+        Sqrt,
+        Cbrt,
+        Ln,
+        Lg,
+        Log,
+        Arcsin,
+        Arccos,
+        Arctan,
+        Negative,
+        Pow,
+        Mul,
+        Div,
+        Plus,
+        Minus
+    };
+
+    /**
+     * How much of a range of arguments an expression is defined on.
+     */
+    enum class Domain : std::uint8_t {
+        /// Never NaN for arguments in the range.
+        Inside,
+        /// May be NaN for some arguments in the range.
+        Partial,
+        /// NaN for every argument in the range.
+        Outside
+    };
+
+    /**
+     * Range [lo, hi] of numbers. As a result of Expression::evaluate_interval it encloses every value of
+     * the expression that is not NaN, with infinite bounds where values are unbounded, and domain tells
+     * where NaN may appear. Bounds are NaN when domain is Outside.
+     */
+    struct Interval {
+        double lo = 0.0;
+        double hi = 0.0;
+        Domain domain = Domain::Inside;
+
+        [[nodiscard]] bool contains(const double v) const { return lo <= v && v <= hi; }
+    };
+
+    namespace detail {
+        inline constexpr double infinity = std::numeric_limits<double>::infinity();
+
+        [[nodiscard]] inline Interval undefined() {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            return {nan, nan, Domain::Outside};
+        }
+
+        [[nodiscard]] inline Interval whole(const Domain domain) {
+            return {-infinity, infinity, domain};
+        }
+
+        [[nodiscard]] inline Domain worst(const Domain a, const Domain b) {
+            return a > b ? a : b;
+        }
+
+        /**
+         * Smallest interval containing a and b, widened by ulps units in the last place on both sides so
+         * that it also contains values rounded differently, e.g. by libm between the bounds.
+         */
+        [[nodiscard]] inline Interval enclose(const double a, const double b, const Domain domain, const int ulps) {
+            Interval result{a < b ? a : b, a < b ? b : a, domain};
+            for (int i = 0; i < ulps; ++i) {
+                result.lo = std::nextafter(result.lo, -infinity);
+                result.hi = std::nextafter(result.hi, infinity);
+            }
+            return result;
+        }
+
+        /**
+         * Whether some point phase + k * period is in [lo, hi] or close enough to it that rounding of
+         * k * period could move it inside.
+         */
+        [[nodiscard]] inline bool hits(const double lo, const double hi, const double phase, const double period) {
+            const double slack = 8 * std::numeric_limits<double>::epsilon()
+                                 * std::max({std::abs(lo), std::abs(hi), std::abs(phase)});
+            return phase + std::ceil((lo - slack - phase) / period) * period <= hi + slack;
+        }
+
+        /**
+         * Interval of a function increasing on the whole domain [min, max] of its argument, NaN outside.
+         */
+        template<typename F>
+        [[nodiscard]] Interval increasing(const Interval& t, F f, const double min = -infinity,
+                                          const double max = infinity) {
+            if (t.domain == Domain::Outside || t.hi < min || t.lo > max) {
+                return undefined();
+            }
+            const Domain domain = t.lo < min || t.hi > max ? worst(t.domain, Domain::Partial) : t.domain;
+            return enclose(f(t.lo < min ? min : t.lo), f(t.hi > max ? max : t.hi), domain, 2);
+        }
+
+        /**
+         * Interval of a logarithm: increasing for positive arguments, NaN for the others.
+         */
+        template<typename F>
+        [[nodiscard]] Interval logarithm(const Interval& t, F f) {
+            if (t.domain == Domain::Outside || t.hi <= 0) {
+                return undefined();
+            }
+            if (t.lo <= 0) {
+                return enclose(-infinity, f(t.hi), worst(t.domain, Domain::Partial), 2);
+            }
+            return enclose(f(t.lo), f(t.hi), t.domain, 2);
+        }
+    } // namespace az::detail
+
     struct Expression {
-        [[nodiscard]] virtual double evaluate(double x) = 0;
+        [[nodiscard]] virtual double evaluate(double x) const = 0;
+        /**
+         * Evaluates expression with variables[i] as the value of variable in slot i. X reads slot 0.
+         */
+        [[nodiscard]] virtual double evaluate(std::span<const double> variables) const = 0;
+        /**
+         * Encloses values of the expression for every x in the given range.
+         */
+        [[nodiscard]] virtual Interval evaluate_interval(Interval x) const = 0;
+        /**
+         * Encloses values of the expression for every combination of variable values in the given ranges.
+         */
+        [[nodiscard]] virtual Interval evaluate_interval(std::span<const Interval> variables) const = 0;
+        [[nodiscard]] virtual Kind kind() const = 0;
 
         virtual ~Expression() = default;
     };
 
+    struct UnaryExpression : Expression {
+        explicit UnaryExpression(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+
+        std::shared_ptr<Expression> prod;
+    };
+
+    struct BinaryExpression : Expression {
+        explicit BinaryExpression(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
+            : lhs(std::move(l)), rhs(std::move(r)) {}
+
+        std::shared_ptr<Expression> lhs;
+        std::shared_ptr<Expression> rhs;
+    };
+
     struct Number : Expression {
         Number(const std::string& i, const std::optional<std::string>& f) : value(
             f ? std::stod(i + "." + *f) : std::stod(i)) {}
 
+        explicit Number(const double v) : value(v) {}
+
         double value;
 
-        [[nodiscard]] double evaluate(const double x) override {
+        [[nodiscard]] double evaluate(const double x) const override {
+            return value;
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
             return value;
         }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return std::isnan(value) ? detail::undefined() : Interval{value, value};
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return std::isnan(value) ? detail::undefined() : Interval{value, value};
+        }
+
+        static constexpr Kind type = Kind::Number;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
     struct X : Expression {
         X() = default;
 
-        [[nodiscard]] double evaluate(const double x) override {
+        [[nodiscard]] double evaluate(const double x) const override {
+            return x;
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return variables[0];
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
             return x;
         }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return variables[0];
+        }
+
+        static constexpr Kind type = Kind::X;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Sin : Expression {
-        explicit Sin(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    /**
+     * Named variable, resolved at parse time to the index of its value in the variables array.
+     */
+    struct Variable : Expression {
+        explicit Variable(const std::uint32_t s) : slot(s) {}
+
+        std::uint32_t slot;
+
+        /**
+         * Single argument is the value of slot 0, variables in other slots are NaN.
+         */
+        [[nodiscard]] double evaluate(const double x) const override {
+            return evaluate(std::span<const double>(&x, 1));
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return slot < variables.size() ? variables[slot] : std::numeric_limits<double>::quiet_NaN();
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return evaluate_interval(std::span<const Interval>(&x, 1));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return slot < variables.size() ? variables[slot] : detail::undefined();
+        }
+
+        static constexpr Kind type = Kind::Variable;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    /**
+     * Names of variables an expression may use, declared up front. Name at index i is bound to slot i.
+     * Names are identifiers (letters, digits and underscores, not starting with a digit) other than
+     * function names.
+     */
+    class Variables {
+    public:
+        Variables(const std::initializer_list<std::string_view> names) : names_(names.begin(), names.end()) {}
+
+        explicit Variables(std::vector<std::string> names) : names_(std::move(names)) {}
+
+        [[nodiscard]] std::optional<std::uint32_t> slot(const std::string_view name) const {
+            for (std::size_t i = 0; i < names_.size(); ++i) {
+                if (names_[i] == name) {
+                    return static_cast<std::uint32_t>(i);
+                }
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] std::span<const std::string> names() const { return names_; }
+
+        [[nodiscard]] std::size_t size() const { return names_.size(); }
+
+    private:
+        std::vector<std::string> names_;
+    };
+
+    /**
+     * Where parsing of an invalid expression failed: byte offset into the input and name of the grammar
+     * production being parsed there.
+     */
+    struct SyntaxError {
+        std::size_t offset = 0;
+        std::string production;
+    };
+
+    /**
+     * Magnitude below which Div and Cot treat the divisor as zero. It is about epsilon^(2/3) of the type,
+     * which keeps 1e-10 for double.
+     */
+    template<std::floating_point T>
+    inline constexpr T domain_epsilon = T(1e-10);
+
+    template<>
+    inline constexpr float domain_epsilon<float> = 1e-5f;
+
+    template<>
+    inline constexpr long double domain_epsilon<long double> = 1e-13L;
+
+    struct Sin : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             return std::isnan(t) ? t : std::sin(t);
         }
+
+        /**
+         * apply() without domain checks, for NanPolicy::Fast: NaN and infinity propagate as in IEEE 754.
+         */
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::sin(t);
+        }
+
+        /**
+         * Bounds at the ends of t, extended to -1 or 1 where t contains a minimum or maximum of sine.
+         */
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            if (t.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            if (!std::isfinite(t.lo) || !std::isfinite(t.hi)) {
+                return {-1.0, 1.0, Domain::Partial};
+            }
+            constexpr double pi = std::numbers::pi;
+            Interval result = detail::enclose(std::sin(t.lo), std::sin(t.hi), t.domain, 2);
+            result.lo = detail::hits(t.lo, t.hi, -pi / 2, 2 * pi) ? -1.0 : std::max(result.lo, -1.0);
+            result.hi = detail::hits(t.lo, t.hi, pi / 2, 2 * pi) ? 1.0 : std::min(result.hi, 1.0);
+            return result;
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Sin;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Cos : Expression {
-        explicit Cos(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Cos : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             return std::isnan(t) ? t : std::cos(t);
         }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::cos(t);
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            if (t.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            if (!std::isfinite(t.lo) || !std::isfinite(t.hi)) {
+                return {-1.0, 1.0, Domain::Partial};
+            }
+            constexpr double pi = std::numbers::pi;
+            Interval result = detail::enclose(std::cos(t.lo), std::cos(t.hi), t.domain, 2);
+            result.lo = detail::hits(t.lo, t.hi, pi, 2 * pi) ? -1.0 : std::max(result.lo, -1.0);
+            result.hi = detail::hits(t.lo, t.hi, 0.0, 2 * pi) ? 1.0 : std::min(result.hi, 1.0);
+            return result;
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Cos;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Tan : Expression {
-        explicit Tan(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Tan : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             return std::isnan(t) ? t : std::tan(t);
         }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::tan(t);
+        }
+
+        /**
+         * Increasing between poles at pi/2 + k*pi, unbounded if t contains one.
+         */
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            if (t.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            if (!std::isfinite(t.lo) || !std::isfinite(t.hi)) {
+                return detail::whole(Domain::Partial);
+            }
+            if (detail::hits(t.lo, t.hi, std::numbers::pi / 2, std::numbers::pi)) {
+                return detail::whole(t.domain);
+            }
+            return detail::enclose(std::tan(t.lo), std::tan(t.hi), t.domain, 2);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Tan;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Cot : Expression {
-        explicit Cot(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Cot : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             if (std::isnan(t)) {
                 return t;
             }
-            const double sin = std::sin(t);
+            const T sin = std::sin(t);
 
-            if (std::abs(sin) < 1e-10) {
-                return std::nan("");
+            if (std::abs(sin) < domain_epsilon<T>) {
+                return std::numeric_limits<T>::quiet_NaN();
             }
 
             return std::cos(t) / sin;
         }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::cos(t) / std::sin(t);
+        }
+
+        /**
+         * Decreasing between poles at k*pi, which are NaN, unbounded if t contains one.
+         */
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            if (t.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            if (!std::isfinite(t.lo) || !std::isfinite(t.hi)) {
+                return detail::whole(Domain::Partial);
+            }
+            // apply() is NaN where sine is below domain_epsilon, which is within about that distance of a pole.
+            constexpr double margin = 2 * domain_epsilon<double>;
+            if (detail::hits(t.lo - margin, t.hi + margin, 0.0, std::numbers::pi)) {
+                return detail::whole(detail::worst(t.domain, Domain::Partial));
+            }
+            return detail::enclose(apply(t.hi), apply(t.lo), t.domain, 4);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Cot;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Sqrt : Expression {
-        explicit Sqrt(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Sqrt : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             if (std::isnan(t)) {
                 return t;
             }
 
-            return t < 0.0 ? std::nan("") : std::sqrt(t);
+            return t < 0 ? std::numeric_limits<T>::quiet_NaN() : std::sqrt(t);
         }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::sqrt(t);
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::increasing(t, [](const double v) { return std::sqrt(v); }, 0.0);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Sqrt;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Cbrt : Expression {
-        explicit Cbrt(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Cbrt : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             return std::isnan(t) ? t : std::cbrt(t);
         }
-    };
 
-    struct Ln : Expression {
-        explicit Ln(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::cbrt(t);
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::increasing(t, [](const double v) { return std::cbrt(v); });
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Cbrt;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
-            if (t <= 0.0) {
-                return std::nan("");
+    struct Ln : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
+            if (t <= 0) {
+                return std::numeric_limits<T>::quiet_NaN();
             }
             return std::isnan(t) ? t : std::log(t);
         }
-    };
 
-    struct Lg : Expression {
-        explicit Lg(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::log(t);
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::logarithm(t, [](const double v) { return std::log(v); });
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Ln;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    struct Lg : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
-            if (t <= 0.0) {
-                return std::nan("");
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
+            if (t <= 0) {
+                return std::numeric_limits<T>::quiet_NaN();
             }
             return std::isnan(t) ? t : std::log2(t);
         }
-    };
 
-    struct Log : Expression {
-        explicit Log(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::log2(t);
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::logarithm(t, [](const double v) { return std::log2(v); });
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Lg;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
-            if (t <= 0.0) {
-                return std::nan("");
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    struct Log : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
+            if (t <= 0) {
+                return std::numeric_limits<T>::quiet_NaN();
             }
             return std::isnan(t) ? t : std::log10(t);
         }
-    };
 
-    struct Arcsin : Expression {
-        explicit Arcsin(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::log10(t);
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::logarithm(t, [](const double v) { return std::log10(v); });
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        static constexpr Kind type = Kind::Log;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    struct Arcsin : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             if (std::isnan(t)) {
                 return t;
             }
 
-            if (t > std::numbers::pi /2 || t < -std::numbers::pi / 2) {
-                return std::nan("");
+            if (t > std::numbers::pi_v<T> / 2 || t < -std::numbers::pi_v<T> / 2) {
+                return std::numeric_limits<T>::quiet_NaN();
             }
 
             return std::asin(t);
         }
-    };
 
-    struct Arccos : Expression {
-        explicit Arccos(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::asin(t);
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::increasing(t, [](const double v) { return std::asin(v); }, -1.0, 1.0);
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Arcsin;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    struct Arccos : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
             if (std::isnan(t)) {
                 return t;
             }
 
             if (t > 1 || t < -1) {
-                return std::nan("");
+                return std::numeric_limits<T>::quiet_NaN();
             }
 
             return std::acos(t);
         }
-    };
 
-    struct Arctan : Expression {
-        explicit Arctan(std::shared_ptr<Expression> p) : prod(std::move(p)) {}
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::acos(t);
+        }
 
-        std::shared_ptr<Expression> prod;
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            const Interval r = detail::increasing(t, [](const double v) { return -std::acos(v); }, -1.0, 1.0);
+            return {-r.hi, -r.lo, r.domain};
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
 
-            return std::isnan(t) ? t : std::atan(t);
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
         }
+
+        static constexpr Kind type = Kind::Arccos;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Negative : Expression {
-        explicit Negative(std::shared_ptr<Expression> p) : prod(std::move(p)) {};
-        std::shared_ptr<Expression> prod;
+    struct Arctan : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
+            return std::isnan(t) ? t : std::atan(t);
+        }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return std::atan(t);
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return detail::increasing(t, [](const double v) { return std::atan(v); });
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double t = prod->evaluate(x);
-            return std::isnan(t) ? t : -prod->evaluate(x);
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
         }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Arctan;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Pow : Expression {
-        explicit Pow(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
-            : lhs(std::move(l)), rhs(std::move(r)) {};
-        std::shared_ptr<Expression> lhs;
-        std::shared_ptr<Expression> rhs;
+    struct Negative : UnaryExpression {
+        using UnaryExpression::UnaryExpression;
+
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T t) {
+            return std::isnan(t) ? t : -t;
+        }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T t) {
+            return -t;
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& t) {
+            return t.domain == Domain::Outside ? detail::undefined() : Interval{-t.hi, -t.lo, t.domain};
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(prod->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(prod->evaluate(variables));
+        }
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double l = lhs->evaluate(x);
-            const double r = rhs->evaluate(x);
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(prod->evaluate_interval(x));
+        }
 
-            return std::isnan(l) || std::isnan(r) ? std::nan("") : std::pow(l, r);
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(prod->evaluate_interval(variables));
         }
+
+        static constexpr Kind type = Kind::Negative;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Mul : Expression {
-        explicit Mul(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
-            : lhs(std::move(l)), rhs(std::move(r)) {};
-        std::shared_ptr<Expression> lhs;
-        std::shared_ptr<Expression> rhs;
+    struct Pow : BinaryExpression {
+        using BinaryExpression::BinaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double l = lhs->evaluate(x);
-            const double r = rhs->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T l, const T r) {
+            return std::isnan(l) || std::isnan(r) ? std::numeric_limits<T>::quiet_NaN() : std::pow(l, r);
+        }
 
-            return std::isnan(l) || std::isnan(r) ? std::nan("") : l * r;
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T l, const T r) {
+            return std::pow(l, r);
         }
+
+        /**
+         * Constant exponents are handled exactly: integer ones for any base, others for the non-negative
+         * part of it. Otherwise bounds are taken at the corners, which needs a non-negative base.
+         */
+        [[nodiscard]] static Interval interval(const Interval& l, const Interval& r) {
+            if (l.domain == Domain::Outside || r.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            const Domain domain = detail::worst(l.domain, r.domain);
+            const double magnitude = std::max(std::abs(l.lo), std::abs(l.hi));
+            const double mignitude = l.contains(0.0) ? 0.0 : std::min(std::abs(l.lo), std::abs(l.hi));
+            if (r.lo == r.hi && std::isfinite(r.lo) && std::trunc(r.lo) == r.lo) {
+                const double p = r.lo;
+                const bool even = std::fmod(p, 2.0) == 0.0;
+                if (p == 0) {
+                    return {1.0, 1.0, domain};
+                }
+                if (p > 0) {
+                    return even ? detail::enclose(std::pow(mignitude, p), std::pow(magnitude, p), domain, 2)
+                                : detail::enclose(std::pow(l.lo, p), std::pow(l.hi, p), domain, 2);
+                }
+                if (l.contains(0.0)) {
+                    return even ? Interval{std::nextafter(std::pow(magnitude, p), 0.0), detail::infinity, domain}
+                                : detail::whole(domain);
+                }
+                return even ? detail::enclose(std::pow(magnitude, p), std::pow(mignitude, p), domain, 2)
+                            : detail::enclose(std::pow(l.hi, p), std::pow(l.lo, p), domain, 2);
+            }
+
+            const bool constant = r.lo == r.hi && std::isfinite(r.lo);
+            if (l.hi < 0 && constant) {
+                return detail::undefined();
+            }
+            if (l.lo < 0) {
+                if (!constant) {
+                    return detail::whole(detail::worst(domain, Domain::Partial));
+                }
+                return detail::enclose(std::pow(0.0, r.lo), std::pow(l.hi, r.lo),
+                                       detail::worst(domain, Domain::Partial), 2);
+            }
+            const double a = std::pow(l.lo, r.lo);
+            const double b = std::pow(l.lo, r.hi);
+            const double c = std::pow(l.hi, r.lo);
+            const double d = std::pow(l.hi, r.hi);
+            return detail::enclose(std::min({a, b, c, d}), std::max({a, b, c, d}), domain, 2);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(lhs->evaluate(x), rhs->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(lhs->evaluate(variables), rhs->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(lhs->evaluate_interval(x), rhs->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(lhs->evaluate_interval(variables), rhs->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Pow;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Div : Expression {
-        explicit Div(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
-            : lhs(std::move(l)), rhs(std::move(r)) {};
-        std::shared_ptr<Expression> lhs;
-        std::shared_ptr<Expression> rhs;
+    struct Mul : BinaryExpression {
+        using BinaryExpression::BinaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double l = lhs->evaluate(x);
-            const double r = rhs->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T l, const T r) {
+            return std::isnan(l) || std::isnan(r) ? std::numeric_limits<T>::quiet_NaN() : l * r;
+        }
 
-            if (std::isnan(l) || std::isnan(r)) {
-                return std::nan("");
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T l, const T r) {
+            return l * r;
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& l, const Interval& r) {
+            if (l.domain == Domain::Outside || r.domain == Domain::Outside) {
+                return detail::undefined();
             }
+            const Domain domain = detail::worst(l.domain, r.domain);
+            // 0 * inf is NaN.
+            const bool l_infinite = std::isinf(l.lo) || std::isinf(l.hi);
+            const bool r_infinite = std::isinf(r.lo) || std::isinf(r.hi);
+            if ((l.contains(0.0) && r_infinite) || (r.contains(0.0) && l_infinite)) {
+                return detail::whole(detail::worst(domain, Domain::Partial));
+            }
+            const double a = l.lo * r.lo;
+            const double b = l.lo * r.hi;
+            const double c = l.hi * r.lo;
+            const double d = l.hi * r.hi;
+            return detail::enclose(std::min({a, b, c, d}), std::max({a, b, c, d}), domain, 1);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(lhs->evaluate(x), rhs->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(lhs->evaluate(variables), rhs->evaluate(variables));
+        }
 
-            return std::abs(r) > 1e-10 ? lhs->evaluate(x) / r : std::nan("");
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(lhs->evaluate_interval(x), rhs->evaluate_interval(x));
         }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(lhs->evaluate_interval(variables), rhs->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Mul;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Plus : Expression {
-        explicit Plus(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
-            : lhs(std::move(l)), rhs(std::move(r)) {};
-        std::shared_ptr<Expression> lhs;
-        std::shared_ptr<Expression> rhs;
+    struct Div : BinaryExpression {
+        using BinaryExpression::BinaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double l = lhs->evaluate(x);
-            const double r = rhs->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T l, const T r) {
+            if (std::isnan(l) || std::isnan(r)) {
+                return std::numeric_limits<T>::quiet_NaN();
+            }
+
+            return std::abs(r) > domain_epsilon<T> ? l / r : std::numeric_limits<T>::quiet_NaN();
+        }
 
-            return std::isnan(l) || std::isnan(r) ? std::nan("") : l + r;
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T l, const T r) {
+            return l / r;
         }
+
+        /**
+         * Divisors of magnitude at most domain_epsilon give NaN, so they are cut out of r and the quotient
+         * is bounded over the remaining parts of it.
+         */
+        [[nodiscard]] static Interval interval(const Interval& l, const Interval& r) {
+            constexpr double epsilon = domain_epsilon<double>;
+            if (l.domain == Domain::Outside || r.domain == Domain::Outside || (r.lo >= -epsilon && r.hi <= epsilon)) {
+                return detail::undefined();
+            }
+            Interval result{detail::infinity, -detail::infinity, detail::worst(l.domain, r.domain)};
+            if (r.lo <= epsilon && r.hi >= -epsilon) {
+                result.domain = detail::worst(result.domain, Domain::Partial);
+            }
+            const auto divide = [&](const double lo, const double hi) {
+                for (const double n : {l.lo, l.hi}) {
+                    for (const double d : {lo, hi}) {
+                        const double q = n / d;
+                        if (std::isnan(q)) {
+                            // inf / inf
+                            result = detail::whole(detail::worst(result.domain, Domain::Partial));
+                        } else {
+                            result.lo = std::min(result.lo, q);
+                            result.hi = std::max(result.hi, q);
+                        }
+                    }
+                }
+            };
+            if (r.lo < -epsilon) {
+                divide(r.lo, std::min(r.hi, -epsilon));
+            }
+            if (r.hi > epsilon) {
+                divide(std::max(r.lo, epsilon), r.hi);
+            }
+            return detail::enclose(result.lo, result.hi, result.domain, 1);
+        }
+
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(lhs->evaluate(x), rhs->evaluate(x));
+        }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(lhs->evaluate(variables), rhs->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(lhs->evaluate_interval(x), rhs->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(lhs->evaluate_interval(variables), rhs->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Div;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    struct Minus : Expression {
-        explicit Minus(std::shared_ptr<Expression> l, std::shared_ptr<Expression> r)
-            : lhs(std::move(l)), rhs(std::move(r)) {};
-        std::shared_ptr<Expression> lhs;
-        std::shared_ptr<Expression> rhs;
+    struct Plus : BinaryExpression {
+        using BinaryExpression::BinaryExpression;
 
-        [[nodiscard]] double evaluate(const double x) override {
-            const double l = lhs->evaluate(x);
-            const double r = rhs->evaluate(x);
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T l, const T r) {
+            return std::isnan(l) || std::isnan(r) ? std::numeric_limits<T>::quiet_NaN() : l + r;
+        }
+
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T l, const T r) {
+            return l + r;
+        }
+
+        [[nodiscard]] static Interval interval(const Interval& l, const Interval& r) {
+            if (l.domain == Domain::Outside || r.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            const Domain domain = detail::worst(l.domain, r.domain);
+            // inf + -inf is NaN.
+            if ((l.hi == detail::infinity && r.lo == -detail::infinity)
+                || (l.lo == -detail::infinity && r.hi == detail::infinity)) {
+                return detail::whole(detail::worst(domain, Domain::Partial));
+            }
+            return detail::enclose(l.lo + r.lo, l.hi + r.hi, domain, 1);
+        }
 
-            return std::isnan(l) || std::isnan(r) ? std::nan("") : l - r;
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(lhs->evaluate(x), rhs->evaluate(x));
         }
+
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(lhs->evaluate(variables), rhs->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(lhs->evaluate_interval(x), rhs->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(lhs->evaluate_interval(variables), rhs->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Plus;
+
+        [[nodiscard]] Kind kind() const override { return type; }
     };
 
-    namespace {
-        namespace grammar {
-            namespace dsl = lexy::dsl;
+    struct Minus : BinaryExpression {
+        using BinaryExpression::BinaryExpression;
 
-            struct number {
-                struct integer {
-                    static constexpr auto rule = dsl::capture(dsl::digits<>.no_leading_zero());
-                    static constexpr auto value = lexy::as_string<std::string>;
-                };
+        template<std::floating_point T>
+        [[nodiscard]] static T apply(const T l, const T r) {
+            return std::isnan(l) || std::isnan(r) ? std::numeric_limits<T>::quiet_NaN() : l - r;
+        }
 
-                struct fraction {
-                    static constexpr auto rule = dsl::capture(dsl::digits<>);
-                    static constexpr auto value = lexy::as_string<std::string>;
-                };
+        template<std::floating_point T>
+        [[nodiscard]] static T fast(const T l, const T r) {
+            return l - r;
+        }
 
-                static constexpr auto rule = dsl::p<integer> >> dsl::opt(dsl::period >> dsl::p<fraction>);
+        [[nodiscard]] static Interval interval(const Interval& l, const Interval& r) {
+            if (l.domain == Domain::Outside || r.domain == Domain::Outside) {
+                return detail::undefined();
+            }
+            const Domain domain = detail::worst(l.domain, r.domain);
+            // inf - inf is NaN.
+            if ((l.hi == detail::infinity && r.hi == detail::infinity)
+                || (l.lo == -detail::infinity && r.lo == -detail::infinity)) {
+                return detail::whole(detail::worst(domain, Domain::Partial));
+            }
+            return detail::enclose(l.lo - r.hi, l.hi - r.lo, domain, 1);
+        }
 
-                static constexpr auto value =
-                        lexy::callback<std::shared_ptr<Number>>(
-                            [](const std::string& i, const std::optional<std::string>& f) {
-                                return std::make_shared<Number>(i, f);
-                            });
-            };
+        [[nodiscard]] double evaluate(const double x) const override {
+            return apply(lhs->evaluate(x), rhs->evaluate(x));
+        }
 
-            struct x {
-                static constexpr auto rule = dsl::lit_c<'x'>;
-                static constexpr auto value = lexy::callback<std::shared_ptr<X>>([]() {
-                    return std::make_shared<X>();
-                });
-            };
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const override {
+            return apply(lhs->evaluate(variables), rhs->evaluate(variables));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const Interval x) const override {
+            return interval(lhs->evaluate_interval(x), rhs->evaluate_interval(x));
+        }
+
+        [[nodiscard]] Interval evaluate_interval(const std::span<const Interval> variables) const override {
+            return interval(lhs->evaluate_interval(variables), rhs->evaluate_interval(variables));
+        }
+
+        static constexpr Kind type = Kind::Minus;
+
+        [[nodiscard]] Kind kind() const override { return type; }
+    };
+
+    namespace {
+        namespace grammar {
+            namespace dsl = lexy::dsl;
 
             template<typename T>
             auto callback = [](std::shared_ptr<Expression> p) { return std::make_shared<T>(p); };
@@ -337,65 +1217,174 @@ namespace az {
             constexpr auto op_div = dsl::op(dsl::lit_c<'/'>);
             constexpr auto op_pow = dsl::op(dsl::lit_c<'^'>);
 
-            struct expression : lexy::expression_production {
+            /**
+             * Converts number matched by the grammar straight from the input range. Unlike std::stod, from_chars
+             * does not depend on the locale and needs no null-terminated copy of the digits. Numbers out of the
+             * range of double round like IEEE 754 arithmetic: too large ones to infinity, too small ones to 0.
+             */
+            template<typename Lexeme>
+            double to_double(const Lexeme& lexeme) {
+                double value = 0.0;
+                const auto [end, error] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+                if (error == std::errc::result_out_of_range) {
+                    // Numbers have no exponent and no leading zeros, so only fractions 0.000... can be too small.
+                    return *lexeme.data() == '0' ? 0.0 : std::numeric_limits<double>::infinity();
+                }
+                return value;
+            }
+
+            constexpr auto identifier =
+                    dsl::identifier(dsl::ascii::alpha_underscore, dsl::ascii::alpha_digit_underscore);
+
+            /**
+             * Builds tree of shared Expression nodes. Grammar productions are templated on the builder, so the
+             * same grammar can produce different representations of the parsed expression.
+             */
+            struct tree_builder {
+                using node = std::shared_ptr<Expression>;
+
+                static constexpr auto number = lexy::callback<std::shared_ptr<Number>>([](const auto& lexeme) {
+                    return std::make_shared<Number>(to_double(lexeme));
+                });
+
+                static constexpr auto x = lexy::callback<std::shared_ptr<X>>([]() {
+                    return std::make_shared<X>();
+                });
+
+                template<typename T>
+                static constexpr auto unary = lexy::callback<std::shared_ptr<T>>(callback<T>);
+
+                static constexpr auto expression = lexy::callback<std::shared_ptr<Expression>>(
+                    forwardCallback<Number>,
+                    forwardCallback<X>,
+                    forwardCallback<Sin>,
+                    forwardCallback<Cos>,
+                    forwardCallback<Tan>,
+                    forwardCallback<Cot>,
+                    forwardCallback<Sqrt>,
+                    forwardCallback<Cbrt>,
+                    forwardCallback<Ln>,
+                    forwardCallback<Lg>,
+                    forwardCallback<Log>,
+                    forwardCallback<Arcsin>,
+                    forwardCallback<Arccos>,
+                    forwardCallback<Arctan>,
+                    forwardCallback<Expression>,
+                    [](lexy::op<op_minus>, const std::shared_ptr<Expression>& e) {
+                        return std::make_shared<Negative>(e);
+                    },
+                    binOperatorCallback<lexy::op<op_pow>, Pow>,
+                    binOperatorCallback<lexy::op<op_mul>, Mul>,
+                    binOperatorCallback<lexy::op<op_div>, Div>,
+                    binOperatorCallback<lexy::op<op_plus>, Plus>,
+                    binOperatorCallback<lexy::op<op_minus>, Minus>);
+            };
+
+            /**
+             * Parse state of variable_builder. Names missing from variables are recorded in unknown, as the
+             * grammar itself accepts any identifier.
+             */
+            struct variable_scope {
+                const Variables& variables;
+                mutable bool unknown = false;
+            };
+
+            /**
+             * Builds tree in which identifiers are variables resolved to their slots, instead of the single x.
+             */
+            struct variable_builder : tree_builder {
+                static constexpr auto variable = lexy::callback_with_state<std::shared_ptr<Expression>>(
+                    [](const variable_scope& scope, const auto& name) -> std::shared_ptr<Expression> {
+                        const auto slot = scope.variables.slot(std::string_view(name.data(), name.size()));
+                        if (!slot) {
+                            scope.unknown = true;
+                            return std::make_shared<Number>(std::numeric_limits<double>::quiet_NaN());
+                        }
+                        return std::make_shared<Variable>(*slot);
+                    });
+            };
+
+            template<typename Builder>
+            struct basic_number {
+                // Whole number is captured as one lexeme pointing into the input, nothing is copied.
+                static constexpr auto rule = dsl::capture(
+                    dsl::token(dsl::digits<>.no_leading_zero() + dsl::opt(dsl::period >> dsl::digits<>)));
+
+                static constexpr auto value = Builder::number;
+            };
+
+            template<typename Builder>
+            struct basic_x {
+                static constexpr auto rule = dsl::lit_c<'x'>;
+                static constexpr auto value = Builder::x;
+            };
+
+            template<typename Builder>
+            struct basic_variable {
+                static constexpr auto rule = identifier;
+                static constexpr auto value = Builder::variable;
+            };
+
+            template<typename Builder>
+            struct basic_expression : lexy::expression_production {
                 struct sin {
-                    static constexpr auto rule = dsl::lit<"sin"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Sin>>(callback<Sin>);
+                    static constexpr auto rule = dsl::keyword<"sin">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Sin>;
                 };
 
                 struct cos {
-                    static constexpr auto rule = dsl::lit<"cos"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Cos>>(callback<Cos>);
+                    static constexpr auto rule = dsl::keyword<"cos">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Cos>;
                 };
 
                 struct tan {
-                    static constexpr auto rule = dsl::lit<"tan"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Tan>>(callback<Tan>);
+                    static constexpr auto rule = dsl::keyword<"tan">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Tan>;
                 };
 
                 struct cot {
-                    static constexpr auto rule = dsl::lit<"cot"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Cot>>(callback<Cot>);
+                    static constexpr auto rule = dsl::keyword<"cot">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Cot>;
                 };
 
                 struct sqrt {
-                    static constexpr auto rule = dsl::lit<"sqrt"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Sqrt>>(callback<Sqrt>);
+                    static constexpr auto rule = dsl::keyword<"sqrt">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Sqrt>;
                 };
 
                 struct cbrt {
-                    static constexpr auto rule = dsl::lit<"cbrt"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Cbrt>>(callback<Cbrt>);
+                    static constexpr auto rule = dsl::keyword<"cbrt">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Cbrt>;
                 };
 
                 struct ln {
-                    static constexpr auto rule = dsl::lit<"ln"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Ln>>(callback<Ln>);
+                    static constexpr auto rule = dsl::keyword<"ln">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Ln>;
                 };
 
                 struct lg {
-                    static constexpr auto rule = dsl::lit<"lg"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Lg>>(callback<Lg>);
+                    static constexpr auto rule = dsl::keyword<"lg">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Lg>;
                 };
 
                 struct log {
-                    static constexpr auto rule = dsl::lit<"log"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Log>>(callback<Log>);
+                    static constexpr auto rule = dsl::keyword<"log">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Log>;
                 };
 
                 struct arcsin {
-                    static constexpr auto rule = dsl::lit<"arcsin"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Arcsin>>(callback<Arcsin>);
+                    static constexpr auto rule = dsl::keyword<"arcsin">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Arcsin>;
                 };
 
                 struct arccos {
-                    static constexpr auto rule = dsl::lit<"arccos"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Arccos>>(callback<Arccos>);
+                    static constexpr auto rule = dsl::keyword<"arccos">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Arccos>;
                 };
 
                 struct arctan {
-                    static constexpr auto rule = dsl::lit<"arctan"> >> dsl::parenthesized(dsl::p<expression>);
-                    static constexpr auto value = lexy::callback<std::shared_ptr<Arctan>>(callback<Arctan>);
+                    static constexpr auto rule = dsl::keyword<"arctan">(identifier) >> dsl::parenthesized(dsl::p<basic_expression>);
+                    static constexpr auto value = Builder::template unary<Arctan>;
                 };
 
                 static constexpr auto whitespace = dsl::ascii::space;
@@ -403,7 +1392,15 @@ namespace az {
                     constexpr auto function =
                             dsl::p<sin> | dsl::p<cos> | dsl::p<tan> | dsl::p<cot> | dsl::p<sqrt> | dsl::p<cbrt>
                             | dsl::p<ln> | dsl::p<lg> | dsl::p<log> | dsl::p<arcsin> | dsl::p<arccos> | dsl::p<arctan>;
-                    return function | dsl::p<number> | dsl::p<x> | dsl::parenthesized(dsl::p<expression>);
+                    constexpr auto leaf = [] {
+                        if constexpr (requires { Builder::variable; }) {
+                            return dsl::p<basic_variable<Builder>>;
+                        } else {
+                            return dsl::p<basic_x<Builder>>;
+                        }
+                    }();
+                    return function | dsl::p<basic_number<Builder>> | leaf
+                           | dsl::parenthesized(dsl::p<basic_expression>);
                 }();
 
                 struct power : dsl::infix_op_right {
@@ -427,41 +1424,28 @@ namespace az {
                 };
 
                 using operation = sum;
-                static constexpr auto value = lexy::callback<std::shared_ptr<Expression>>(
-                    forwardCallback<Number>,
-                    forwardCallback<X>,
-                    forwardCallback<Sin>,
-                    forwardCallback<Cos>,
-                    forwardCallback<Tan>,
-                    forwardCallback<Cot>,
-                    forwardCallback<Sqrt>,
-                    forwardCallback<Cbrt>,
-                    forwardCallback<Ln>,
-                    forwardCallback<Lg>,
-                    forwardCallback<Log>,
-                    forwardCallback<Arcsin>,
-                    forwardCallback<Arccos>,
-                    forwardCallback<Arctan>,
-                    forwardCallback<Expression>,
-                    [](lexy::op<op_minus>, const std::shared_ptr<Expression>& e) {
-                        return std::make_shared<Negative>(e);
-                    },
-                    binOperatorCallback<lexy::op<op_pow>, Pow>,
-                    binOperatorCallback<lexy::op<op_mul>, Mul>,
-                    binOperatorCallback<lexy::op<op_div>, Div>,
-                    binOperatorCallback<lexy::op<op_plus>, Plus>,
-                    binOperatorCallback<lexy::op<op_minus>, Minus>);
+                static constexpr auto value = Builder::expression;
             };
 
-            struct exp {
-                static constexpr auto rule = dsl::p<expression> + dsl::eof;
-                static constexpr auto value = lexy::forward<std::shared_ptr<Expression>>;
+            template<typename Builder>
+            struct basic_exp {
+                static constexpr auto rule = dsl::p<basic_expression<Builder>> + dsl::eof;
+                static constexpr auto value = lexy::forward<typename Builder::node>;
             };
+
+            using number = basic_number<tree_builder>;
+            using x = basic_x<tree_builder>;
+            using expression = basic_expression<tree_builder>;
+            using exp = basic_exp<tree_builder>;
         }
     } // namespace az::<anonymous>::grammar
 
-    inline std::shared_ptr<Expression> parse_expression(const std::string& input) {
-        const auto exp = lexy::string_input(input);
+    /**
+     * Parses expression directly from the given characters. No copy of the input or its parts is made.
+     * Returns nullptr if the expression is invalid.
+     */
+    inline std::shared_ptr<Expression> parse_expression(const std::string_view input) {
+        const auto exp = lexy::string_input(input.data(), input.size());
         const auto result =
                 lexy::parse<grammar::exp>(exp, lexy::noop);
 
@@ -469,6 +1453,48 @@ namespace az {
             return nullptr;
         return result.value();
     }
+
+    /**
+     * Parses expression like parse_expression(input), but on failure also reports location of the first
+     * syntax error in error.
+     */
+    inline std::shared_ptr<Expression> parse_expression(const std::string_view input, SyntaxError& error) {
+        struct Location {
+            const char* production;
+            const char* position;
+        };
+        const auto locate = lexy::callback<Location>([](const auto& context, const auto& e) {
+            return Location{context.production(), e.position()};
+        });
+
+        const auto exp = lexy::string_input(input.data(), input.size());
+        const auto result =
+                lexy::parse<grammar::exp>(exp, lexy::collect<std::vector<Location>>(locate));
+
+        if (result.has_value() && !result.is_error())
+            return result.value();
+        if (!result.errors().empty()) {
+            const Location& first = result.errors().front();
+            error = {static_cast<std::size_t>(first.position - input.data()), first.production};
+        }
+        return nullptr;
+    }
+
+    /**
+     * Parses expression using declared variables instead of x. Every name is replaced by Variable holding
+     * its slot, so evaluation never looks names up. Returns nullptr if the expression is invalid or uses
+     * an undeclared name.
+     */
+    inline std::shared_ptr<Expression> parse_expression(const std::string_view input, const Variables& variables) {
+        const grammar::variable_scope scope{variables};
+        const auto exp = lexy::string_input(input.data(), input.size());
+        const auto result =
+                lexy::parse<grammar::basic_exp<grammar::variable_builder>>(exp, scope, lexy::noop);
+
+        if (!result.has_value() || result.is_error() || scope.unknown)
+            return nullptr;
+        return result.value();
+    }
 } // namespace az
 
 #endif //FUNCTION_PARSER_FUNCTION_PARSER_HPP
@@ -0,0 +1,128 @@
+#ifndef FUNCTION_PARSER_FUSED_HPP
+#define FUNCTION_PARSER_FUSED_HPP
+
+#include "cse.hpp"
+#include "function_parser.hpp"
+#include "program.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace az {
+    /**
+     * Many expressions compiled into one program over the same argument. Subtrees common to several
+     * expressions are computed once. Batch evaluation runs the whole program block by block and stores the
+     * value of each expression into its own column as soon as it is computed, so its register is reused
+     * afterwards and the argument is loaded once per block for all expressions.
+     */
+    class FusedProgram {
+    public:
+        /// Value of expression i is in register reg after the first end instructions.
+        struct Output {
+            std::size_t end;
+            std::uint32_t reg;
+        };
+
+        FusedProgram() = default;
+
+        FusedProgram(Program program, std::vector<Output> outputs, const std::size_t nodes_before)
+            : program_(std::move(program)), outputs_(std::move(outputs)), nodes_before_(nodes_before) {}
+
+        /**
+         * Evaluates every expression at x and stores value of expression i in out[i].
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate(const double x, const std::span<double> out) const {
+            assert(program_.variables() <= 1);
+            assert(out.size() >= outputs_.size());
+            std::vector<double> r(program_.registers());
+            const std::span<const Instruction> code = program_.instructions();
+            std::size_t begin = 0;
+            for (std::size_t i = 0; i < outputs_.size(); ++i) {
+                if (outputs_[i].end > begin) {
+                    detail::run<P>(code.subspan(begin, outputs_[i].end - begin), r.data(), &x);
+                    begin = outputs_[i].end;
+                }
+                out[i] = r[outputs_[i].reg];
+            }
+        }
+
+        /**
+         * Evaluates every expression for every value of xs. columns[i] receives values of expression i and
+         * must be at least as long as xs.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate_batch(const std::span<const double> xs,
+                            const std::span<const std::span<double>> columns) const {
+            assert(program_.variables() <= 1);
+            assert(columns.size() >= outputs_.size());
+            std::vector<double> r(static_cast<std::size_t>(program_.registers()) * detail::block_size);
+            const std::span<const Instruction> code = program_.instructions();
+            for (std::size_t first = 0; first < xs.size(); first += detail::block_size) {
+                const std::size_t n = std::min(detail::block_size, xs.size() - first);
+                const double* const argument[] = {xs.data() + first};
+                std::size_t begin = 0;
+                for (std::size_t i = 0; i < outputs_.size(); ++i) {
+                    assert(columns[i].size() >= xs.size());
+                    detail::run_block<P>(code.subspan(begin, outputs_[i].end - begin), r.data(), argument, n);
+                    begin = outputs_[i].end;
+                    std::copy_n(r.data() + outputs_[i].reg * detail::block_size, n, columns[i].data() + first);
+                }
+            }
+        }
+
+        /**
+         * Number of expressions.
+         */
+        [[nodiscard]] std::size_t size() const { return outputs_.size(); }
+
+        [[nodiscard]] std::span<const Instruction> instructions() const { return program_.instructions(); }
+
+        [[nodiscard]] std::span<const Output> outputs() const { return outputs_; }
+
+        [[nodiscard]] std::uint32_t registers() const { return program_.registers(); }
+
+        /**
+         * Total number of nodes of the expressions, as if each was compiled on its own.
+         */
+        [[nodiscard]] std::size_t nodes_before() const { return nodes_before_; }
+
+    private:
+        Program program_;
+        std::vector<Output> outputs_;
+        std::size_t nodes_before_ = 0;
+    };
+
+    /**
+     * Compiles expressions of x into one FusedProgram. Structurally identical subtrees are merged across all
+     * of them first, as by eliminate_common_subexpressions. Running simplify on each expression first lets
+     * more of them be merged.
+     */
+    inline FusedProgram compile_fused(const std::span<const std::shared_ptr<Expression>> expressions) {
+        detail::HashConser merge;
+        std::vector<std::shared_ptr<Expression>> merged;
+        std::vector<const Expression*> roots;
+        std::size_t nodes_before = 0;
+        for (const std::shared_ptr<Expression>& expression : expressions) {
+            nodes_before += count_nodes(*expression);
+            merged.push_back(merge(expression));
+            roots.push_back(merged.back().get());
+        }
+        detail::Compiler<Expression> compiler{std::span<const Expression* const>(roots)};
+        std::vector<FusedProgram::Output> outputs;
+        for (const Expression* root : roots) {
+            const std::uint32_t reg = compiler.emit_root(*root);
+            outputs.push_back({compiler.size(), reg});
+        }
+        return {compiler.finish(), std::move(outputs), nodes_before};
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_FUSED_HPP
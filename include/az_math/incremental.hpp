@@ -0,0 +1,448 @@
+#ifndef FUNCTION_PARSER_INCREMENTAL_HPP
+#define FUNCTION_PARSER_INCREMENTAL_HPP
+
+#include "function_parser.hpp"
+#include "tree.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace az {
+    /**
+     * Replacement of removed characters starting at offset by inserted ones.
+     */
+    struct TextEdit {
+        std::size_t offset = 0;
+        std::size_t removed = 0;
+        std::string_view inserted;
+    };
+
+    namespace detail {
+        /// Prefix of names standing for parenthesized groups in the text given to the grammar.
+        constexpr std::string_view group_placeholder = "__az_group_";
+
+        /**
+         * Parenthesized part of the text, [begin, end) including both brackets, parsed on its own. Nested
+         * groups are replaced by placeholder variables in skeleton and substituted back in tree. The root
+         * group spans the whole text and has no brackets.
+         */
+        struct SourceGroup {
+            std::size_t begin = 0;
+            std::size_t end = 0;
+            std::shared_ptr<Expression> skeleton;
+            std::shared_ptr<Expression> tree;
+            std::vector<std::unique_ptr<SourceGroup>> children;
+            /// Nodes of tree built for skeleton nodes, kept while their operands stay the same.
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>> built;
+
+            void shift(const std::ptrdiff_t delta) {
+                begin += delta;
+                end += delta;
+                for (const auto& child : children) {
+                    child->shift(delta);
+                }
+            }
+
+            [[nodiscard]] std::unique_ptr<SourceGroup> clone(const std::ptrdiff_t delta) const {
+                auto copy = std::make_unique<SourceGroup>();
+                copy->begin = begin + delta;
+                copy->end = end + delta;
+                copy->skeleton = skeleton;
+                copy->tree = tree;
+                copy->built = built;
+                for (const auto& child : children) {
+                    copy->children.push_back(child->clone(delta));
+                }
+                return copy;
+            }
+        };
+    } // namespace az::detail
+
+    /**
+     * Keeps parsed expression in sync with its text under edits. Every parenthesized group, including
+     * function arguments, is parsed separately, so an edit re-runs the grammar only on the innermost group
+     * containing it; groups of the old text that are reproduced verbatim keep their subtrees. Expressions
+     * after edits are equal to parse_expression of the new text, nodes outside the edited path are shared
+     * with the previous expression and nodes created by the last edit are reported by changed().
+     */
+    class IncrementalParser {
+    public:
+        explicit IncrementalParser(std::string text) : text_(std::move(text)) {
+            rebuild();
+            collect_changed(nullptr);
+        }
+
+        IncrementalParser(std::string text, Variables variables)
+            : text_(std::move(text)), variables_(std::move(variables)) {
+            rebuild();
+            collect_changed(nullptr);
+        }
+
+        /**
+         * Applies edit to the text and reparses it. Returns false if the new text is invalid, expression()
+         * is nullptr then until an edit makes it valid again.
+         */
+        bool edit(const TextEdit& edit) {
+            assert(edit.offset <= text_.size() && edit.removed <= text_.size() - edit.offset);
+            const std::shared_ptr<Expression> previous = expression_;
+            const bool was_valid = valid_;
+            text_.replace(edit.offset, edit.removed, edit.inserted);
+            reparsed_ = 0;
+            if (!was_valid || !update(edit)) {
+                rebuild();
+            }
+            collect_changed(previous.get());
+            return expression_ != nullptr;
+        }
+
+        [[nodiscard]] const std::shared_ptr<Expression>& expression() const { return expression_; }
+
+        [[nodiscard]] const std::string& text() const { return text_; }
+
+        /**
+         * Location of the syntax error of invalid text. Only filled for expressions in x.
+         */
+        [[nodiscard]] const SyntaxError& error() const { return error_; }
+
+        /**
+         * Nodes of expression() created by the last edit. Every other node was already part of the previous
+         * expression, with the same value, so results cached for it stay valid.
+         */
+        [[nodiscard]] std::span<const Expression* const> changed() const { return changed_; }
+
+        /**
+         * Number of characters given to the grammar by the last edit or construction.
+         */
+        [[nodiscard]] std::size_t reparsed() const { return reparsed_; }
+
+    private:
+        using NodeKey = std::tuple<Kind, const Expression*, const Expression*, double>;
+
+        /**
+         * Parse of the text before an edit: its groups by source text and its nodes by kind, operands and
+         * value (slot for variables).
+         */
+        struct Previous {
+            std::unordered_multimap<std::string_view, const detail::SourceGroup*> groups;
+            std::map<NodeKey, std::shared_ptr<Expression>> nodes;
+        };
+
+        /**
+         * Reparses the innermost group containing the edit. Returns false if it is not valid on its own.
+         */
+        bool update(const TextEdit& edit) {
+            const std::size_t edit_end = edit.offset + edit.removed;
+            const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(edit.inserted.size())
+                                         - static_cast<std::ptrdiff_t>(edit.removed);
+            if (contains_placeholder()) {
+                return false;
+            }
+
+            std::vector<std::pair<detail::SourceGroup*, std::size_t>> path{{root_.get(), 0}};
+            for (bool found = true; found;) {
+                found = false;
+                const auto& children = path.back().first->children;
+                for (std::size_t i = 0; i < children.size(); ++i) {
+                    if (children[i]->begin < edit.offset && edit_end < children[i]->end) {
+                        path.emplace_back(children[i].get(), i);
+                        found = true;
+                        break;
+                    }
+                }
+            }
+
+            const detail::SourceGroup& edited = *path.back().first;
+            Previous previous;
+            for (const auto& child : edited.children) {
+                collect(*child, previous);
+            }
+            collect(edited.tree, previous);
+            auto group = parse_group(edited.begin, edited.end + delta, path.size() == 1, previous);
+            if (!group) {
+                return false;
+            }
+
+            if (path.size() == 1) {
+                root_ = std::move(group);
+            } else {
+                path[path.size() - 2].first->children[path.back().second] = std::move(group);
+                for (std::size_t n = path.size() - 1; n-- > 0;) {
+                    detail::SourceGroup& ancestor = *path[n].first;
+                    ancestor.end += delta;
+                    for (const auto& child : ancestor.children) {
+                        if (child->begin >= edit_end) {
+                            child->shift(delta);
+                        }
+                    }
+                    build(ancestor, first_placeholder(), nullptr);
+                }
+            }
+            synced();
+            return true;
+        }
+
+        /**
+         * Parses the whole text, reusing groups and nodes of the last valid one.
+         */
+        void rebuild() {
+            expression_ = nullptr;
+            valid_ = false;
+            if (!contains_placeholder()) {
+                Previous previous;
+                if (root_) {
+                    for (const auto& child : root_->children) {
+                        collect(*child, previous);
+                    }
+                    collect(root_->tree, previous);
+                }
+                if (auto group = parse_group(0, text_.size(), true, previous)) {
+                    root_ = std::move(group);
+                    synced();
+                    return;
+                }
+            }
+
+            reparsed_ += text_.size();
+            error_ = {};
+            if (variables_) {
+                expression_ = parse_expression(text_, *variables_);
+            } else {
+                expression_ = parse_expression(text_, error_);
+            }
+        }
+
+        void synced() {
+            parsed_text_ = text_;
+            expression_ = root_->tree;
+            valid_ = true;
+            error_ = {};
+        }
+
+        [[nodiscard]] bool contains_placeholder() const {
+            return text_.find(detail::group_placeholder) != std::string::npos;
+        }
+
+        [[nodiscard]] std::size_t first_placeholder() const {
+            return variables_ ? variables_->size() : 1;
+        }
+
+        void collect(const detail::SourceGroup& group, Previous& previous) const {
+            previous.groups.emplace(std::string_view(parsed_text_).substr(group.begin, group.end - group.begin), &group);
+            for (const auto& child : group.children) {
+                collect(*child, previous);
+            }
+        }
+
+        static void collect(const std::shared_ptr<Expression>& node, Previous& previous) {
+            const auto [l, r] = children(*node);
+            const Kind kind = node->kind();
+            const double value = kind == Kind::Number ? number_value(*node)
+                                 : kind == Kind::Variable ? variable_slot(*node) : 0.0;
+            if (!previous.nodes.try_emplace({kind, l, r, value}, node).second) {
+                return;
+            }
+            if (is_binary(kind)) {
+                const auto& b = static_cast<const BinaryExpression&>(*node);
+                collect(b.lhs, previous);
+                collect(b.rhs, previous);
+            } else if (is_unary(kind)) {
+                collect(static_cast<const UnaryExpression&>(*node).prod, previous);
+            }
+        }
+
+        /**
+         * Parses group spanning [begin, end) of the text. Nested groups with the same text as a previous
+         * group are copied from it with their subtrees, others are parsed recursively.
+         */
+        std::unique_ptr<detail::SourceGroup> parse_group(const std::size_t begin, const std::size_t end,
+                                                         const bool root, Previous& previous) {
+            auto group = std::make_unique<detail::SourceGroup>();
+            group->begin = begin;
+            group->end = end;
+
+            std::vector<std::string> names;
+            if (variables_) {
+                const auto declared = variables_->names();
+                names.assign(declared.begin(), declared.end());
+            } else {
+                names.emplace_back("x");
+            }
+
+            const std::size_t inner_begin = root ? begin : begin + 1;
+            const std::size_t inner_end = root ? end : end - 1;
+            std::string skeleton = root ? "" : "(";
+            std::size_t copied = inner_begin;
+            for (std::size_t i = inner_begin; i < inner_end; ++i) {
+                if (text_[i] == ')') {
+                    return nullptr;
+                }
+                if (text_[i] != '(') {
+                    continue;
+                }
+                std::size_t close = i + 1;
+                for (std::size_t depth = 1; close < inner_end; ++close) {
+                    if (text_[close] == '(') {
+                        ++depth;
+                    } else if (text_[close] == ')' && --depth == 0) {
+                        break;
+                    }
+                }
+                if (close == inner_end) {
+                    return nullptr;
+                }
+
+                const std::string_view source = std::string_view(text_).substr(i, close + 1 - i);
+                std::unique_ptr<detail::SourceGroup> child;
+                if (const auto it = previous.groups.find(source); it != previous.groups.end()) {
+                    const auto moved = static_cast<std::ptrdiff_t>(i) - static_cast<std::ptrdiff_t>(it->second->begin);
+                    child = it->second->clone(moved);
+                } else if (!(child = parse_group(i, close + 1, false, previous))) {
+                    return nullptr;
+                }
+
+                const std::string name = std::string(detail::group_placeholder) + std::to_string(group->children.size());
+                skeleton.append(text_, copied, i - copied).append("(").append(name).append(")");
+                names.push_back(name);
+                group->children.push_back(std::move(child));
+                copied = close + 1;
+                i = close;
+            }
+            skeleton.append(text_, copied, inner_end - copied);
+            if (!root) {
+                skeleton += ')';
+            }
+
+            reparsed_ += skeleton.size();
+            group->skeleton = parse_expression(skeleton, Variables(std::move(names)));
+            if (!group->skeleton) {
+                return nullptr;
+            }
+            build(*group, first_placeholder(), &previous);
+            return group;
+        }
+
+        /**
+         * Substitutes subtrees of nested groups for placeholders of the skeleton. Nodes equal to a previous
+         * node, or whose operands did not change since the last build of the group, are reused.
+         */
+        void build(detail::SourceGroup& group, const std::size_t first_placeholder, const Previous* previous) const {
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>> built;
+            group.tree = substitute(group, group.skeleton, first_placeholder, previous, built);
+            group.built = std::move(built);
+        }
+
+        std::shared_ptr<Expression> substitute(
+            const detail::SourceGroup& group, const std::shared_ptr<Expression>& node,
+            const std::size_t first_placeholder, const Previous* previous,
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>>& built) const {
+            Kind kind = node->kind();
+            std::shared_ptr<Expression> l;
+            std::shared_ptr<Expression> r;
+            double value = 0.0;
+            if (kind == Kind::Number) {
+                value = number_value(*node);
+            } else if (kind == Kind::Variable) {
+                const std::uint32_t slot = variable_slot(*node);
+                if (slot >= first_placeholder) {
+                    return group.children[slot - first_placeholder]->tree;
+                }
+                if (variables_) {
+                    value = slot;
+                } else {
+                    kind = Kind::X;
+                }
+            } else if (is_binary(kind)) {
+                const auto& b = static_cast<const BinaryExpression&>(*node);
+                l = substitute(group, b.lhs, first_placeholder, previous, built);
+                r = substitute(group, b.rhs, first_placeholder, previous, built);
+            } else {
+                l = substitute(group, static_cast<const UnaryExpression&>(*node).prod, first_placeholder, previous,
+                               built);
+            }
+
+            const std::pair<const Expression*, const Expression*> operands{l.get(), r.get()};
+            if (previous) {
+                if (const auto it = previous->nodes.find({kind, l.get(), r.get(), value}); it != previous->nodes.end()) {
+                    return built[node.get()] = it->second;
+                }
+            }
+            if (kind != Kind::X && operands == children(*node)) {
+                return node;
+            }
+            if (const auto old = group.built.find(node.get()); old != group.built.end()
+                && operands == children(*old->second)) {
+                return built[node.get()] = old->second;
+            }
+
+            std::shared_ptr<Expression> result;
+            if (kind == Kind::X) {
+                result = std::make_shared<X>();
+            } else if (is_binary(kind)) {
+                result = make_binary(kind, std::move(l), std::move(r));
+            } else {
+                result = make_unary(kind, std::move(l));
+            }
+            return built[node.get()] = std::move(result);
+        }
+
+        void collect_changed(const Expression* previous) {
+            changed_.clear();
+            if (!expression_) {
+                return;
+            }
+            std::unordered_set<const Expression*> old;
+            if (previous) {
+                std::vector<const Expression*> stack{previous};
+                while (!stack.empty()) {
+                    const Expression* node = stack.back();
+                    stack.pop_back();
+                    if (!old.insert(node).second) {
+                        continue;
+                    }
+                    const auto [l, r] = children(*node);
+                    if (l) stack.push_back(l);
+                    if (r) stack.push_back(r);
+                }
+            }
+            std::unordered_set<const Expression*> seen;
+            std::vector<const Expression*> stack{expression_.get()};
+            while (!stack.empty()) {
+                const Expression* node = stack.back();
+                stack.pop_back();
+                if (old.contains(node) || !seen.insert(node).second) {
+                    continue;
+                }
+                changed_.push_back(node);
+                const auto [l, r] = children(*node);
+                if (l) stack.push_back(l);
+                if (r) stack.push_back(r);
+            }
+        }
+
+        std::string text_;
+        std::optional<Variables> variables_;
+        /// Text root_ was parsed from, the last valid one.
+        std::string parsed_text_;
+        std::unique_ptr<detail::SourceGroup> root_;
+        /// Whether root_ describes text_.
+        bool valid_ = false;
+        std::shared_ptr<Expression> expression_;
+        SyntaxError error_;
+        std::vector<const Expression*> changed_;
+        std::size_t reparsed_ = 0;
+    };
+} // namespace az
+
+#endif //FUNCTION_PARSER_INCREMENTAL_HPP
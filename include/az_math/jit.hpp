@@ -0,0 +1,352 @@
+#ifndef FUNCTION_PARSER_JIT_HPP
+#define FUNCTION_PARSER_JIT_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+#if !defined(AZ_MATH_NO_JIT) && defined(__x86_64__) && defined(__linux__)
+#define AZ_MATH_JIT 1
+#include <sys/mman.h>
+#endif
+
+namespace az {
+    using NativeFunction = double (*)(double);
+    using NativeBatchFunction = void (*)(const double* xs, double* out, std::size_t n);
+
+    namespace detail {
+        /**
+         * Executable memory holding generated code. Pages are written first and then switched to
+         * read and execute, so they are never writable and executable at the same time.
+         */
+        class CodeBuffer {
+        public:
+            CodeBuffer() = default;
+
+            explicit CodeBuffer(const std::vector<std::uint8_t>& code) {
+#ifdef AZ_MATH_JIT
+                void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (memory == MAP_FAILED) {
+                    return;
+                }
+                std::memcpy(memory, code.data(), code.size());
+                if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+                    munmap(memory, code.size());
+                    return;
+                }
+                memory_ = memory;
+                size_ = code.size();
+#endif
+            }
+
+            CodeBuffer(CodeBuffer&& other) noexcept
+                : memory_(std::exchange(other.memory_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+            CodeBuffer& operator=(CodeBuffer&& other) noexcept {
+                std::swap(memory_, other.memory_);
+                std::swap(size_, other.size_);
+                return *this;
+            }
+
+            ~CodeBuffer() {
+#ifdef AZ_MATH_JIT
+                if (memory_) {
+                    munmap(memory_, size_);
+                }
+#endif
+            }
+
+            [[nodiscard]] const std::uint8_t* data() const { return static_cast<const std::uint8_t*>(memory_); }
+
+        private:
+            void* memory_ = nullptr;
+            std::size_t size_ = 0;
+        };
+
+        /**
+         * Emits System V x86-64 code for a Program. Every register of the program lives in a stack slot
+         * [rsp + 8 * register], the argument in the slot after them. Arithmetic and square root are done
+         * inline with SSE2, other operations call apply() of their node.
+         */
+        class Assembler {
+        public:
+            explicit Assembler(const Program& program)
+                : program_(program), argument_(program.registers()),
+                  // Keeps rsp 16-byte aligned at calls: entry rsp is 8 mod 16, four pushes keep it so.
+                  frame_(((program.registers() + 1) * 8 + 15) / 16 * 16 + 8) {}
+
+            /// double f(double x)
+            std::vector<std::uint8_t> scalar() {
+                code_.clear();
+                sub_rsp(frame_);
+                sse(0xF2, 0x11, 0, argument_);
+                body();
+                sse(0xF2, 0x10, 0, result());
+                add_rsp(frame_);
+                byte(0xC3);
+                return std::move(code_);
+            }
+
+            /// void f(const double* xs, double* out, std::size_t n)
+            std::vector<std::uint8_t> batch() {
+                code_.clear();
+                bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56}); // push rbx, r12, r13, r14
+                sub_rsp(frame_);
+                bytes({0x49, 0x89, 0xFC}); // mov r12, rdi
+                bytes({0x49, 0x89, 0xF5}); // mov r13, rsi
+                bytes({0x49, 0x89, 0xD6}); // mov r14, rdx
+                bytes({0x31, 0xDB}); // xor ebx, ebx
+
+                const std::size_t loop = code_.size();
+                bytes({0x4C, 0x39, 0xF3}); // cmp rbx, r14
+                bytes({0x0F, 0x83}); // jae end
+                const std::size_t exit = code_.size();
+                imm32(0);
+
+                bytes({0xF2, 0x41, 0x0F, 0x10, 0x04, 0xDC}); // movsd xmm0, [r12 + rbx * 8]
+                sse(0xF2, 0x11, 0, argument_);
+                body();
+                sse(0xF2, 0x10, 0, result());
+                bytes({0xF2, 0x41, 0x0F, 0x11, 0x44, 0xDD, 0x00}); // movsd [r13 + rbx * 8], xmm0
+                bytes({0x48, 0xFF, 0xC3}); // inc rbx
+                byte(0xE9); // jmp loop
+                imm32(static_cast<std::int32_t>(loop) - static_cast<std::int32_t>(code_.size() + 4));
+
+                patch32(exit, static_cast<std::int32_t>(code_.size()) - static_cast<std::int32_t>(exit + 4));
+                add_rsp(frame_);
+                bytes({0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B}); // pop r14, r13, r12, rbx
+                byte(0xC3);
+                return std::move(code_);
+            }
+
+        private:
+            [[nodiscard]] std::uint32_t result() const {
+                return program_.instructions().back().dst;
+            }
+
+            void body() {
+                for (const Instruction& i : program_.instructions()) {
+                    switch (i.op) {
+                        case Kind::Number:
+                            mov_rax(std::bit_cast<std::uint64_t>(i.value));
+                            bytes({0x48, 0x89, 0x84, 0x24}); // mov [rsp + disp32], rax
+                            imm32(static_cast<std::int32_t>(i.dst * 8));
+                            break;
+                        case Kind::X:
+                        case Kind::Variable: // only slot 0, see JitFunction
+                            sse(0xF2, 0x10, 0, argument_);
+                            sse(0xF2, 0x11, 0, i.dst);
+                            break;
+                        case Kind::Plus:
+                            arithmetic(0x58, i);
+                            break;
+                        case Kind::Minus:
+                            arithmetic(0x5C, i);
+                            break;
+                        case Kind::Mul:
+                            arithmetic(0x59, i);
+                            break;
+                        case Kind::Sqrt:
+                            // Hardware square root gives NaN for negative arguments, as Sqrt::apply does.
+                            sse(0xF2, 0x51, 0, i.lhs);
+                            sse(0xF2, 0x11, 0, i.dst);
+                            break;
+                        case Kind::Negative:
+                            sse(0xF2, 0x10, 0, i.lhs);
+                            mov_rax(0x8000000000000000);
+                            movq_xmm_rax(1);
+                            packed(0x57, 0, 1); // xorpd xmm0, xmm1
+                            sse(0xF2, 0x11, 0, i.dst);
+                            break;
+                        case Kind::Div:
+                            division(i);
+                            break;
+                        case Kind::Pow: call(i, &Pow::apply<double>); break;
+                        case Kind::Sin: call(i, &Sin::apply<double>); break;
+                        case Kind::Cos: call(i, &Cos::apply<double>); break;
+                        case Kind::Tan: call(i, &Tan::apply<double>); break;
+                        case Kind::Cot: call(i, &Cot::apply<double>); break;
+                        case Kind::Cbrt: call(i, &Cbrt::apply<double>); break;
+                        case Kind::Ln: call(i, &Ln::apply<double>); break;
+                        case Kind::Lg: call(i, &Lg::apply<double>); break;
+                        case Kind::Log: call(i, &Log::apply<double>); break;
+                        case Kind::Arcsin: call(i, &Arcsin::apply<double>); break;
+                        case Kind::Arccos: call(i, &Arccos::apply<double>); break;
+                        case Kind::Arctan: call(i, &Arctan::apply<double>); break;
+                    }
+                }
+            }
+
+            // Plus, minus and mul: IEEE arithmetic already propagates NaN operands.
+            void arithmetic(const std::uint8_t opcode, const Instruction& i) {
+                sse(0xF2, 0x10, 0, i.lhs);
+                sse(0xF2, opcode, 0, i.rhs);
+                sse(0xF2, 0x11, 0, i.dst);
+            }
+
+            // result = |r| > 1e-10 ? l / r : NaN, computed with masks instead of branches.
+            void division(const Instruction& i) {
+                sse(0xF2, 0x10, 1, i.rhs); // movsd xmm1, r
+                packed(0x28, 2, 1); // movapd xmm2, xmm1
+                mov_rax(0x7FFFFFFFFFFFFFFF);
+                movq_xmm_rax(3);
+                packed(0x54, 2, 3); // andpd xmm2, xmm3 -> |r|
+                mov_rax(std::bit_cast<std::uint64_t>(1e-10));
+                movq_xmm_rax(3);
+                bytes({0xF2, 0x0F, 0xC2, 0xDA, 0x01}); // cmpltsd xmm3, xmm2 -> mask of 1e-10 < |r|
+                sse(0xF2, 0x10, 0, i.lhs); // movsd xmm0, l
+                bytes({0xF2, 0x0F, 0x5E, 0xC1}); // divsd xmm0, xmm1
+                packed(0x54, 0, 3); // andpd xmm0, xmm3
+                mov_rax(0x7FF8000000000000);
+                movq_xmm_rax(4);
+                packed(0x55, 3, 4); // andnpd xmm3, xmm4 -> NaN where mask is clear
+                packed(0x56, 0, 3); // orpd xmm0, xmm3
+                sse(0xF2, 0x11, 0, i.dst);
+            }
+
+            void call(const Instruction& i, double (*function)(double)) {
+                sse(0xF2, 0x10, 0, i.lhs);
+                call(reinterpret_cast<std::uint64_t>(function));
+                sse(0xF2, 0x11, 0, i.dst);
+            }
+
+            void call(const Instruction& i, double (*function)(double, double)) {
+                sse(0xF2, 0x10, 0, i.lhs);
+                sse(0xF2, 0x10, 1, i.rhs);
+                call(reinterpret_cast<std::uint64_t>(function));
+                sse(0xF2, 0x11, 0, i.dst);
+            }
+
+            void call(const std::uint64_t address) {
+                mov_rax(address);
+                bytes({0xFF, 0xD0}); // call rax
+            }
+
+            // <prefix> 0F <opcode> xmm, [rsp + 8 * slot]
+            void sse(const std::uint8_t prefix, const std::uint8_t opcode, const std::uint8_t xmm,
+                     const std::uint32_t slot) {
+                bytes({prefix, 0x0F, opcode, static_cast<std::uint8_t>(0x84 | xmm << 3), 0x24});
+                imm32(static_cast<std::int32_t>(slot * 8));
+            }
+
+            // 66 0F <opcode> xmm, xmm
+            void packed(const std::uint8_t opcode, const std::uint8_t dst, const std::uint8_t src) {
+                bytes({0x66, 0x0F, opcode, static_cast<std::uint8_t>(0xC0 | dst << 3 | src)});
+            }
+
+            void movq_xmm_rax(const std::uint8_t xmm) {
+                bytes({0x66, 0x48, 0x0F, 0x6E, static_cast<std::uint8_t>(0xC0 | xmm << 3)});
+            }
+
+            void mov_rax(const std::uint64_t value) {
+                bytes({0x48, 0xB8});
+                for (int shift = 0; shift < 64; shift += 8) {
+                    byte(static_cast<std::uint8_t>(value >> shift));
+                }
+            }
+
+            void sub_rsp(const std::uint32_t value) {
+                bytes({0x48, 0x81, 0xEC});
+                imm32(static_cast<std::int32_t>(value));
+            }
+
+            void add_rsp(const std::uint32_t value) {
+                bytes({0x48, 0x81, 0xC4});
+                imm32(static_cast<std::int32_t>(value));
+            }
+
+            void imm32(const std::int32_t value) {
+                for (int shift = 0; shift < 32; shift += 8) {
+                    byte(static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >> shift));
+                }
+            }
+
+            void patch32(const std::size_t at, const std::int32_t value) {
+                for (int shift = 0; shift < 32; shift += 8) {
+                    code_[at + shift / 8] = static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >> shift);
+                }
+            }
+
+            void bytes(const std::initializer_list<std::uint8_t> values) {
+                code_.insert(code_.end(), values);
+            }
+
+            void byte(const std::uint8_t value) {
+                code_.push_back(value);
+            }
+
+            const Program& program_;
+            std::uint32_t argument_;
+            std::uint32_t frame_;
+            std::vector<std::uint8_t> code_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Program translated into native x86-64 code. When JIT is not supported (other architecture or
+     * operating system) or turned off by defining AZ_MATH_NO_JIT, or when executable memory cannot be
+     * obtained, JitFunction falls back to evaluating the Program, and function() returns nullptr.
+     * Generated code takes a single argument, so programs reading more than one variable slot are
+     * not translated either.
+     */
+    class JitFunction {
+    public:
+        explicit JitFunction(Program program) : program_(std::move(program)) {
+#ifdef AZ_MATH_JIT
+            if (program_.empty() || program_.variables() > 1) {
+                return;
+            }
+            detail::Assembler assembler(program_);
+            scalar_ = detail::CodeBuffer(assembler.scalar());
+            batch_ = detail::CodeBuffer(assembler.batch());
+            if (!scalar_.data() || !batch_.data()) {
+                scalar_ = {};
+                batch_ = {};
+            }
+#endif
+        }
+
+        [[nodiscard]] bool native() const { return scalar_.data() != nullptr; }
+
+        /**
+         * Plain pointer to generated code, valid while this JitFunction lives; nullptr without JIT.
+         */
+        [[nodiscard]] NativeFunction function() const {
+            return native() ? reinterpret_cast<NativeFunction>(const_cast<std::uint8_t*>(scalar_.data())) : nullptr;
+        }
+
+        [[nodiscard]] NativeBatchFunction batch_function() const {
+            return native() ? reinterpret_cast<NativeBatchFunction>(const_cast<std::uint8_t*>(batch_.data())) : nullptr;
+        }
+
+        [[nodiscard]] double evaluate(const double x) const {
+            return native() ? function()(x) : program_.evaluate(x);
+        }
+
+        void evaluate_batch(const std::span<const double> xs, const std::span<double> out) const {
+            assert(out.size() >= xs.size());
+            if (native()) {
+                batch_function()(xs.data(), out.data(), xs.size());
+            } else {
+                program_.evaluate_batch(xs, out);
+            }
+        }
+
+        [[nodiscard]] const Program& program() const { return program_; }
+
+    private:
+        Program program_;
+        detail::CodeBuffer scalar_;
+        detail::CodeBuffer batch_;
+    };
+} // namespace az
+
+#endif //FUNCTION_PARSER_JIT_HPP
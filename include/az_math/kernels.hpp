@@ -0,0 +1,507 @@
+#ifndef FUNCTION_PARSER_KERNELS_HPP
+#define FUNCTION_PARSER_KERNELS_HPP
+
+#include "function_parser.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AZ_MATH_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace az::detail {
+    /**
+     * Number of lanes processed by one instruction during batch evaluation.
+     */
+    constexpr std::size_t block_size = 256;
+
+    template<typename T>
+    using UnaryKernel = void (*)(const T* t, T* out, std::size_t n);
+    template<typename T>
+    using BinaryKernel = void (*)(const T* l, const T* r, T* out, std::size_t n);
+
+    /**
+     * Block kernels of operations that have direct hardware instructions. Every kernel keeps the
+     * same per lane domain rules as the scalar apply() of its node.
+     */
+    template<typename T>
+    struct BasicKernels {
+        const char* name;
+        BinaryKernel<T> plus;
+        BinaryKernel<T> minus;
+        BinaryKernel<T> mul;
+        BinaryKernel<T> div;
+        /// Division without the domain check, for NanPolicy::Fast.
+        BinaryKernel<T> fast_div;
+        UnaryKernel<T> negative;
+        UnaryKernel<T> sqrt;
+    };
+
+    using Kernels = BasicKernels<double>;
+
+    namespace scalar {
+        template<typename T>
+        void plus(const T* l, const T* r, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Plus::apply(l[i], r[i]);
+        }
+
+        template<typename T>
+        void minus(const T* l, const T* r, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Minus::apply(l[i], r[i]);
+        }
+
+        template<typename T>
+        void mul(const T* l, const T* r, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Mul::apply(l[i], r[i]);
+        }
+
+        template<typename T>
+        void div(const T* l, const T* r, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Div::apply(l[i], r[i]);
+        }
+
+        template<typename T>
+        void fast_div(const T* l, const T* r, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Div::fast(l[i], r[i]);
+        }
+
+        template<typename T>
+        void negative(const T* t, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Negative::apply(t[i]);
+        }
+
+        template<typename T>
+        void sqrt(const T* t, T* out, const std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = Sqrt::apply(t[i]);
+        }
+
+        constexpr Kernels kernels{"scalar", plus, minus, mul, div, fast_div, negative, sqrt};
+        constexpr BasicKernels<float> float_kernels{"scalar", plus, minus, mul, div, fast_div, negative, sqrt};
+        constexpr BasicKernels<long double> long_double_kernels{
+            "scalar", plus, minus, mul, div, fast_div, negative, sqrt
+        };
+    } // namespace az::detail::scalar
+
+#ifdef AZ_MATH_X86_KERNELS
+    // IEEE arithmetic already turns NaN operands into NaN, so plus, minus, mul and negative need no
+    // masks. Division and square root blend NaN into lanes that fail the domain check.
+    namespace avx2 {
+        __attribute__((target("avx2"))) inline void plus(const double* l, const double* r, double* out,
+                                                         const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+            }
+            scalar::plus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void minus(const double* l, const double* r, double* out,
+                                                          const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+            }
+            scalar::minus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void mul(const double* l, const double* r, double* out,
+                                                        const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+            }
+            scalar::mul(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void div(const double* l, const double* r, double* out,
+                                                        const std::size_t n) {
+            const __m256d sign = _mm256_set1_pd(-0.0);
+            const __m256d epsilon = _mm256_set1_pd(domain_epsilon<double>);
+            const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m256d lv = _mm256_loadu_pd(l + i);
+                const __m256d rv = _mm256_loadu_pd(r + i);
+                const __m256d valid = _mm256_cmp_pd(_mm256_andnot_pd(sign, rv), epsilon, _CMP_GT_OQ);
+                _mm256_storeu_pd(out + i, _mm256_blendv_pd(nan, _mm256_div_pd(lv, rv), valid));
+            }
+            scalar::div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void fast_div(const double* l, const double* r, double* out,
+                                                             const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+            }
+            scalar::fast_div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void negative(const double* t, double* out, const std::size_t n) {
+            const __m256d sign = _mm256_set1_pd(-0.0);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(t + i), sign));
+            }
+            scalar::negative(t + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void sqrt(const double* t, double* out, const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                // Hardware square root already yields NaN for negative lanes and keeps -0.0.
+                _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_loadu_pd(t + i)));
+            }
+            scalar::sqrt(t + i, out + i, n - i);
+        }
+
+        // Same operations on 8 float lanes.
+        __attribute__((target("avx2"))) inline void plus(const float* l, const float* r, float* out,
+                                                         const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(l + i), _mm256_loadu_ps(r + i)));
+            }
+            scalar::plus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void minus(const float* l, const float* r, float* out,
+                                                          const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(l + i), _mm256_loadu_ps(r + i)));
+            }
+            scalar::minus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void mul(const float* l, const float* r, float* out,
+                                                        const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(l + i), _mm256_loadu_ps(r + i)));
+            }
+            scalar::mul(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void div(const float* l, const float* r, float* out,
+                                                        const std::size_t n) {
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            const __m256 epsilon = _mm256_set1_ps(domain_epsilon<float>);
+            const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 lv = _mm256_loadu_ps(l + i);
+                const __m256 rv = _mm256_loadu_ps(r + i);
+                const __m256 valid = _mm256_cmp_ps(_mm256_andnot_ps(sign, rv), epsilon, _CMP_GT_OQ);
+                _mm256_storeu_ps(out + i, _mm256_blendv_ps(nan, _mm256_div_ps(lv, rv), valid));
+            }
+            scalar::div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void fast_div(const float* l, const float* r, float* out,
+                                                             const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(l + i), _mm256_loadu_ps(r + i)));
+            }
+            scalar::fast_div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void negative(const float* t, float* out, const std::size_t n) {
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_xor_ps(_mm256_loadu_ps(t + i), sign));
+            }
+            scalar::negative(t + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) inline void sqrt(const float* t, float* out, const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_loadu_ps(t + i)));
+            }
+            scalar::sqrt(t + i, out + i, n - i);
+        }
+
+        constexpr Kernels kernels{"avx2", plus, minus, mul, div, fast_div, negative, sqrt};
+        constexpr BasicKernels<float> float_kernels{"avx2", plus, minus, mul, div, fast_div, negative, sqrt};
+    } // namespace az::detail::avx2
+
+    namespace avx512 {
+        __attribute__((target("avx512f"))) inline void plus(const double* l, const double* r, double* out,
+                                                            const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(l + i), _mm512_loadu_pd(r + i)));
+            }
+            scalar::plus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void minus(const double* l, const double* r, double* out,
+                                                             const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(l + i), _mm512_loadu_pd(r + i)));
+            }
+            scalar::minus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void mul(const double* l, const double* r, double* out,
+                                                           const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(l + i), _mm512_loadu_pd(r + i)));
+            }
+            scalar::mul(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void div(const double* l, const double* r, double* out,
+                                                           const std::size_t n) {
+            const __m512i magnitude = _mm512_set1_epi64(std::numeric_limits<long long>::max());
+            const __m512d epsilon = _mm512_set1_pd(domain_epsilon<double>);
+            const __m512d nan = _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN());
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m512d lv = _mm512_loadu_pd(l + i);
+                const __m512d rv = _mm512_loadu_pd(r + i);
+                const __m512d abs = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(rv), magnitude));
+                const __mmask8 valid = _mm512_cmp_pd_mask(abs, epsilon, _CMP_GT_OQ);
+                _mm512_storeu_pd(out + i, _mm512_mask_div_pd(nan, valid, lv, rv));
+            }
+            scalar::div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void fast_div(const double* l, const double* r, double* out,
+                                                                const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_div_pd(_mm512_loadu_pd(l + i), _mm512_loadu_pd(r + i)));
+            }
+            scalar::fast_div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void negative(const double* t, double* out,
+                                                                const std::size_t n) {
+            const __m512i sign = _mm512_set1_epi64(std::numeric_limits<long long>::min());
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m512i v = _mm512_castpd_si512(_mm512_loadu_pd(t + i));
+                _mm512_storeu_pd(out + i, _mm512_castsi512_pd(_mm512_xor_si512(v, sign)));
+            }
+            scalar::negative(t + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void sqrt(const double* t, double* out, const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_sqrt_pd(_mm512_loadu_pd(t + i)));
+            }
+            scalar::sqrt(t + i, out + i, n - i);
+        }
+
+        // Same operations on 16 float lanes.
+        __attribute__((target("avx512f"))) inline void plus(const float* l, const float* r, float* out,
+                                                            const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(l + i), _mm512_loadu_ps(r + i)));
+            }
+            scalar::plus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void minus(const float* l, const float* r, float* out,
+                                                             const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_sub_ps(_mm512_loadu_ps(l + i), _mm512_loadu_ps(r + i)));
+            }
+            scalar::minus(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void mul(const float* l, const float* r, float* out,
+                                                           const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(l + i), _mm512_loadu_ps(r + i)));
+            }
+            scalar::mul(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void div(const float* l, const float* r, float* out,
+                                                           const std::size_t n) {
+            const __m512i magnitude = _mm512_set1_epi32(std::numeric_limits<int>::max());
+            const __m512 epsilon = _mm512_set1_ps(domain_epsilon<float>);
+            const __m512 nan = _mm512_set1_ps(std::numeric_limits<float>::quiet_NaN());
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m512 lv = _mm512_loadu_ps(l + i);
+                const __m512 rv = _mm512_loadu_ps(r + i);
+                const __m512 abs = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(rv), magnitude));
+                const __mmask16 valid = _mm512_cmp_ps_mask(abs, epsilon, _CMP_GT_OQ);
+                _mm512_storeu_ps(out + i, _mm512_mask_div_ps(nan, valid, lv, rv));
+            }
+            scalar::div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void fast_div(const float* l, const float* r, float* out,
+                                                                const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_div_ps(_mm512_loadu_ps(l + i), _mm512_loadu_ps(r + i)));
+            }
+            scalar::fast_div(l + i, r + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void negative(const float* t, float* out,
+                                                                const std::size_t n) {
+            const __m512i sign = _mm512_set1_epi32(std::numeric_limits<int>::min());
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m512i v = _mm512_castps_si512(_mm512_loadu_ps(t + i));
+                _mm512_storeu_ps(out + i, _mm512_castsi512_ps(_mm512_xor_si512(v, sign)));
+            }
+            scalar::negative(t + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx512f"))) inline void sqrt(const float* t, float* out, const std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_sqrt_ps(_mm512_loadu_ps(t + i)));
+            }
+            scalar::sqrt(t + i, out + i, n - i);
+        }
+
+        constexpr Kernels kernels{"avx512", plus, minus, mul, div, fast_div, negative, sqrt};
+        constexpr BasicKernels<float> float_kernels{"avx512", plus, minus, mul, div, fast_div, negative, sqrt};
+    } // namespace az::detail::avx512
+#endif
+
+    /**
+     * Kernels for the best instruction set supported by the running CPU. Detection runs once. There are
+     * SIMD kernels for double and float, long double always uses the scalar ones.
+     */
+    template<typename T = double>
+    const BasicKernels<T>& kernels() {
+        if constexpr (std::is_same_v<T, long double>) {
+            return scalar::long_double_kernels;
+        } else {
+            static const BasicKernels<T>& selected = [] () -> const BasicKernels<T>& {
+                constexpr bool is_float = std::is_same_v<T, float>;
+#ifdef AZ_MATH_X86_KERNELS
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f")) {
+                    if constexpr (is_float) return avx512::float_kernels; else return avx512::kernels;
+                }
+                if (__builtin_cpu_supports("avx2")) {
+                    if constexpr (is_float) return avx2::float_kernels; else return avx2::kernels;
+                }
+#endif
+                if constexpr (is_float) return scalar::float_kernels; else return scalar::kernels;
+            }();
+            return selected;
+        }
+    }
+
+    /**
+     * Applies unary operation without SIMD counterpart over a block. Domain checks are written as
+     * selects instead of early returns, so compilers with vector math libraries can vectorize them.
+     */
+    template<typename T>
+    void transcendental(const Kind op, const T* t, T* out, const std::size_t n) {
+        constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+        switch (op) {
+            case Kind::Sin:
+                for (std::size_t i = 0; i < n; ++i) out[i] = std::sin(t[i]);
+                break;
+            case Kind::Cos:
+                for (std::size_t i = 0; i < n; ++i) out[i] = std::cos(t[i]);
+                break;
+            case Kind::Tan:
+                for (std::size_t i = 0; i < n; ++i) out[i] = std::tan(t[i]);
+                break;
+            case Kind::Cot:
+                for (std::size_t i = 0; i < n; ++i) {
+                    const T sin = std::sin(t[i]);
+                    out[i] = std::abs(sin) < domain_epsilon<T> ? nan : std::cos(t[i]) / sin;
+                }
+                break;
+            case Kind::Cbrt:
+                for (std::size_t i = 0; i < n; ++i) out[i] = std::cbrt(t[i]);
+                break;
+            case Kind::Ln:
+                for (std::size_t i = 0; i < n; ++i) out[i] = t[i] > 0 ? std::log(t[i]) : nan;
+                break;
+            case Kind::Lg:
+                for (std::size_t i = 0; i < n; ++i) out[i] = t[i] > 0 ? std::log2(t[i]) : nan;
+                break;
+            case Kind::Log:
+                for (std::size_t i = 0; i < n; ++i) out[i] = t[i] > 0 ? std::log10(t[i]) : nan;
+                break;
+            case Kind::Arcsin:
+                for (std::size_t i = 0; i < n; ++i) {
+                    out[i] = t[i] > std::numbers::pi_v<T> / 2 || t[i] < -std::numbers::pi_v<T> / 2 ? nan : std::asin(t[i]);
+                }
+                break;
+            case Kind::Arccos:
+                for (std::size_t i = 0; i < n; ++i) out[i] = t[i] > 1 || t[i] < -1 ? nan : std::acos(t[i]);
+                break;
+            case Kind::Arctan:
+                for (std::size_t i = 0; i < n; ++i) out[i] = std::atan(t[i]);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /**
+     * transcendental() for NanPolicy::Fast, without domain selects.
+     */
+    template<typename T>
+    void fast_transcendental(const Kind op, const T* t, T* out, const std::size_t n) {
+        switch (op) {
+            case Kind::Sin:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Sin::fast(t[i]);
+                break;
+            case Kind::Cos:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Cos::fast(t[i]);
+                break;
+            case Kind::Tan:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Tan::fast(t[i]);
+                break;
+            case Kind::Cot:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Cot::fast(t[i]);
+                break;
+            case Kind::Cbrt:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Cbrt::fast(t[i]);
+                break;
+            case Kind::Ln:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Ln::fast(t[i]);
+                break;
+            case Kind::Lg:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Lg::fast(t[i]);
+                break;
+            case Kind::Log:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Log::fast(t[i]);
+                break;
+            case Kind::Arcsin:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Arcsin::fast(t[i]);
+                break;
+            case Kind::Arccos:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Arccos::fast(t[i]);
+                break;
+            case Kind::Arctan:
+                for (std::size_t i = 0; i < n; ++i) out[i] = Arctan::fast(t[i]);
+                break;
+            default:
+                break;
+        }
+    }
+} // namespace az::detail
+
+#endif //FUNCTION_PARSER_KERNELS_HPP
@@ -0,0 +1,173 @@
+#ifndef FUNCTION_PARSER_LOADER_HPP
+#define FUNCTION_PARSER_LOADER_HPP
+
+#include "function_parser.hpp"
+#include "parallel.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AZ_MATH_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace az {
+    /**
+     * Read-only view of a whole file. The file is memory-mapped where supported, otherwise read into memory.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+#ifdef AZ_MATH_MMAP
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat info{};
+            if (::fstat(fd, &info) == 0) {
+                size_ = static_cast<std::size_t>(info.st_size);
+                if (size_ == 0) {
+                    open_ = true;
+                } else if (void* memory = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    memory != MAP_FAILED) {
+                    ::madvise(memory, size_, MADV_WILLNEED);
+                    memory_ = memory;
+                    open_ = true;
+                }
+            }
+            ::close(fd);
+#else
+            std::ifstream file(path, std::ios::binary);
+            if (file) {
+                copy_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                size_ = copy_.size();
+                open_ = true;
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+#ifdef AZ_MATH_MMAP
+            if (memory_) {
+                ::munmap(memory_, size_);
+            }
+#endif
+        }
+
+        explicit operator bool() const { return open_; }
+
+        [[nodiscard]] std::string_view view() const {
+#ifdef AZ_MATH_MMAP
+            return memory_ ? std::string_view(static_cast<const char*>(memory_), size_) : std::string_view();
+#else
+            return copy_;
+#endif
+        }
+
+        [[nodiscard]] std::span<const std::byte> bytes() const {
+            return std::as_bytes(std::span(view().data(), view().size()));
+        }
+
+    private:
+        void* memory_ = nullptr;
+        std::size_t size_ = 0;
+        bool open_ = false;
+#ifndef AZ_MATH_MMAP
+        std::string copy_;
+#endif
+    };
+
+    /**
+     * Invalid line of a bulk load. Line numbers start at 1, offset is counted in bytes from the start of
+     * the whole input, production is the grammar production that failed.
+     */
+    struct LoadError {
+        std::size_t line;
+        std::size_t offset;
+        std::string production;
+    };
+
+    struct LoadResult {
+        /// Compiled expression of every line in input order. Invalid lines get an empty Program, which
+        /// evaluates to NaN and is kept as an empty entry by save_catalog.
+        std::vector<Program> programs;
+        /// Invalid lines in input order.
+        std::vector<LoadError> errors;
+    };
+
+    struct LoadOptions {
+        /// Number of lines parsed by one thread at a time.
+        std::size_t grain = 1024;
+        /// Pool running the parsing, default_thread_pool() if not set.
+        ThreadPool* pool = nullptr;
+    };
+
+    /**
+     * Parses newline-delimited expressions, one per line, across threads of the pool. Lines are parsed in
+     * place, without being copied. Text after the last newline is a line only if it is not empty; empty
+     * lines in between are invalid expressions like any other.
+     */
+    inline LoadResult load_expressions(const std::string_view text, const LoadOptions& options = {}) {
+        std::vector<std::size_t> starts;
+        for (std::size_t begin = 0; begin < text.size();) {
+            starts.push_back(begin);
+            const void* newline = std::memchr(text.data() + begin, '\n', text.size() - begin);
+            begin = newline ? static_cast<const char*>(newline) - text.data() + 1 : text.size();
+        }
+
+        LoadResult result;
+        result.programs.resize(starts.size());
+        std::mutex errors;
+        ThreadPool& pool = options.pool ? *options.pool : default_thread_pool();
+        pool.parallel_for(starts.size(), options.grain, [&](const std::size_t first, const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                const std::size_t end = i + 1 < starts.size() ? starts[i + 1] - 1
+                                        : text.size() - (text.back() == '\n' ? 1 : 0);
+                const std::string_view line = text.substr(starts[i], end - starts[i]);
+                SyntaxError error;
+                if (const auto tree = parse_expression(line, error)) {
+                    result.programs[i] = compile(*tree);
+                } else {
+                    const std::lock_guard lock(errors);
+                    result.errors.push_back({i + 1, starts[i] + error.offset, std::move(error.production)});
+                }
+            }
+        });
+        std::sort(result.errors.begin(), result.errors.end(), [](const LoadError& a, const LoadError& b) {
+            return a.line < b.line;
+        });
+        return result;
+    }
+
+    /**
+     * Memory-maps the file and loads its expressions with load_expressions. Returns std::nullopt if the
+     * file cannot be read.
+     */
+    inline std::optional<LoadResult> load_expressions_file(const std::string& path, const LoadOptions& options = {}) {
+        const MappedFile file(path);
+        if (!file) {
+            return std::nullopt;
+        }
+        return load_expressions(file.view(), options);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_LOADER_HPP
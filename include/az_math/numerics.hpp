@@ -0,0 +1,551 @@
+#ifndef FUNCTION_PARSER_NUMERICS_HPP
+#define FUNCTION_PARSER_NUMERICS_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/*
+ * Numeric kernels over functions of x. Every step evaluates all points it needs, from all intervals or
+ * brackets being refined, as one batch of a compiled Program. NaN marks arguments out of domain: such parts
+ * of the range are located with interval evaluation and excluded instead of being mixed into the result.
+ */
+
+namespace az {
+    struct IntegrationOptions {
+        /// Error relative to the magnitude of the integral.
+        double tolerance = 1e-10;
+        /// Error accepted however small the integral is.
+        double absolute_tolerance = 1e-14;
+        /// Intervals the range is divided into before refinement.
+        std::size_t initial_intervals = 8;
+        /// Largest number of intervals with the largest error split in one step.
+        std::size_t batch = 64;
+        std::size_t max_evaluations = 1 << 20;
+        /// Width, relative to the whole range, below which intervals are not split. Those where the function
+        /// is NaN or infinite then count as undefined.
+        double resolution = 1e-15;
+    };
+
+    struct Integral {
+        double value = 0.0;
+        /// Estimated absolute error of value.
+        double error = 0.0;
+        /// Total width of the parts of the range where the function is NaN, which are left out of value.
+        double undefined = 0.0;
+        std::size_t evaluations = 0;
+        /// Whether error is within tolerance. If not, the evaluation budget ran out or the integral diverges.
+        bool converged = false;
+    };
+
+    struct RootOptions {
+        /// Absolute width of the bracket at which a root is accepted.
+        double tolerance = 1e-12;
+        /// Evenly spaced points find_roots scans for sign changes, at least 2.
+        std::size_t initial_points = 1025;
+        std::size_t max_iterations = 200;
+    };
+
+    struct ExtremumOptions {
+        /// Largest difference between the value found and the true extremum.
+        double tolerance = 1e-9;
+        /// Evenly spaced intervals the search starts from.
+        std::size_t initial_intervals = 256;
+        std::size_t max_evaluations = 1 << 16;
+        /// Width, relative to the whole range, below which intervals are not split.
+        double resolution = 1e-12;
+    };
+
+    struct Extremum {
+        double x = 0.0;
+        double y = 0.0;
+        /// Bound on the distance of y from the true extremum given by interval evaluation of the parts of
+        /// the range not yet excluded. Infinite if the function may be unbounded near a pole.
+        double error = 0.0;
+        std::size_t evaluations = 0;
+    };
+
+    namespace detail {
+        /// Nodes of the 15-point Kronrod rule on [-1, 1] from 1 to 0; odd ones are nodes of the 7-point
+        /// Gauss rule.
+        constexpr std::array<double, 8> kronrod_nodes{
+            0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+            0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+            0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+            0.207784955007898467600689403773245, 0.0
+        };
+        constexpr std::array<double, 8> kronrod_weights{
+            0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+            0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+            0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+            0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+        };
+        constexpr std::array<double, 4> gauss_weights{
+            0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+            0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+        };
+        constexpr std::size_t kronrod_points = 15;
+
+        struct QuadratureInterval {
+            double lo;
+            double hi;
+            double value;
+            double error;
+            /// Too narrow to be split.
+            bool last;
+        };
+
+        inline void kronrod_abscissae(const double lo, const double hi, std::vector<double>& xs) {
+            const double center = lo + (hi - lo) / 2;
+            const double half = (hi - lo) / 2;
+            for (std::size_t j = 0; j < 7; ++j) {
+                xs.push_back(center - half * kronrod_nodes[j]);
+                xs.push_back(center + half * kronrod_nodes[j]);
+            }
+            xs.push_back(center);
+        }
+
+        /**
+         * Kronrod estimate of the integral over the interval from values at kronrod_abscissae, the
+         * difference from the Gauss estimate as its error. Intervals with NaN or infinite values get
+         * infinite error until they are narrow enough, then they are undefined.
+         */
+        inline QuadratureInterval kronrod(const Expression& function, const double lo, const double hi,
+                                          const double* ys, const double min_width, double& undefined) {
+            const bool last = hi - lo <= min_width;
+            const std::size_t finite = static_cast<std::size_t>(
+                std::count_if(ys, ys + kronrod_points, [](const double y) { return std::isfinite(y); }));
+            if (finite < kronrod_points) {
+                // NaN at every node, an interval proven undefined or one that cannot be split is left out.
+                if (finite == 0 || last || function.evaluate_interval({lo, hi}).domain == Domain::Outside) {
+                    undefined += hi - lo;
+                    return {lo, hi, 0.0, 0.0, true};
+                }
+                return {lo, hi, 0.0, std::numeric_limits<double>::infinity(), false};
+            }
+            const double half = (hi - lo) / 2;
+            double k = kronrod_weights[7] * ys[14];
+            double g = gauss_weights[3] * ys[14];
+            for (std::size_t j = 0; j < 7; ++j) {
+                const double pair = ys[2 * j] + ys[2 * j + 1];
+                k += kronrod_weights[j] * pair;
+                if (j % 2 == 1) {
+                    g += gauss_weights[j / 2] * pair;
+                }
+            }
+            return {lo, hi, k * half, std::abs(k - g) * half, last};
+        }
+
+        /**
+         * State of Brent's method on one bracket, advanced in lockstep with others so that their next
+         * points are evaluated together.
+         */
+        struct BrentBracket {
+            double a;
+            double b;
+            double c;
+            double fa;
+            double fb;
+            double fc;
+            double d;
+            double e;
+            bool done = false;
+
+            BrentBracket(const double a, const double b, const double fa, const double fb)
+                : a(a), b(b), c(b), fa(fa), fb(fb), fc(fb), d(b - a), e(b - a) {}
+
+            /**
+             * Chooses the next point to evaluate and moves b there, or sets done once the bracket is within
+             * tolerance.
+             */
+            void advance(const double tolerance) {
+                if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+                    c = a;
+                    fc = fa;
+                    d = b - a;
+                    e = d;
+                }
+                if (std::abs(fc) < std::abs(fb)) {
+                    a = b;
+                    b = c;
+                    c = a;
+                    fa = fb;
+                    fb = fc;
+                    fc = fa;
+                }
+                const double tol = 2 * std::numeric_limits<double>::epsilon() * std::abs(b) + tolerance / 2;
+                const double m = (c - b) / 2;
+                if (std::abs(m) <= tol || fb == 0) {
+                    done = true;
+                    return;
+                }
+                if (std::abs(e) >= tol && std::abs(fa) > std::abs(fb)) {
+                    // Secant step, or inverse quadratic interpolation once three points are known.
+                    const double s = fb / fa;
+                    double p;
+                    double q;
+                    if (a == c) {
+                        p = 2 * m * s;
+                        q = 1 - s;
+                    } else {
+                        const double r = fb / fc;
+                        q = fa / fc;
+                        p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+                        q = (q - 1) * (r - 1) * (s - 1);
+                    }
+                    if (p > 0) {
+                        q = -q;
+                    }
+                    p = std::abs(p);
+                    if (2 * p < std::min(3 * m * q - std::abs(tol * q), std::abs(e * q))) {
+                        e = d;
+                        d = p / q;
+                    } else {
+                        d = m;
+                        e = d;
+                    }
+                } else {
+                    d = m;
+                    e = d;
+                }
+                a = b;
+                fa = fb;
+                b += std::abs(d) > tol ? d : std::copysign(tol, m);
+            }
+        };
+
+        /**
+         * Runs Brent's method on all brackets, whose ends have values of opposite signs. Returns roots in the
+         * order of the brackets. A bracket where the function is NaN somewhere, or which closes on a pole
+         * rather than a root, gives none.
+         */
+        inline std::vector<double> solve_brackets(const Expression& function, const Program& program,
+                                                  std::vector<BrentBracket> brackets, const RootOptions& options) {
+            std::vector<double> xs;
+            std::vector<double> ys;
+            std::vector<std::size_t> active;
+            for (std::size_t iteration = 0; iteration < options.max_iterations; ++iteration) {
+                xs.clear();
+                active.clear();
+                for (std::size_t i = 0; i < brackets.size(); ++i) {
+                    if (!brackets[i].done) {
+                        brackets[i].advance(options.tolerance);
+                    }
+                    if (!brackets[i].done) {
+                        xs.push_back(brackets[i].b);
+                        active.push_back(i);
+                    }
+                }
+                if (xs.empty()) {
+                    break;
+                }
+                ys.resize(xs.size());
+                program.evaluate_batch(xs, ys);
+                for (std::size_t n = 0; n < active.size(); ++n) {
+                    BrentBracket& bracket = brackets[active[n]];
+                    bracket.fb = ys[n];
+                    if (std::isnan(ys[n])) {
+                        bracket.done = true;
+                    }
+                }
+            }
+
+            std::vector<double> roots;
+            for (const BrentBracket& bracket : brackets) {
+                if (!bracket.done || std::isnan(bracket.fb)) {
+                    continue;
+                }
+                // Around a root of a continuous function the range is bounded, around a pole it is not.
+                const Interval range = bracket.fb == 0
+                                           ? function.evaluate_interval({bracket.b, bracket.b})
+                                           : function.evaluate_interval({std::min(bracket.b, bracket.c),
+                                                                         std::max(bracket.b, bracket.c)});
+                if (range.domain == Domain::Inside && std::isfinite(range.lo) && std::isfinite(range.hi)) {
+                    roots.push_back(bracket.b);
+                }
+            }
+            return roots;
+        }
+
+        struct SearchInterval {
+            double lo;
+            double hi;
+            /// Lower bound of the function on the interval.
+            double bound;
+        };
+
+        /**
+         * Branch and bound search for the global minimum of sign * function. Every step samples the middle of
+         * both halves of all remaining intervals in one batch, then drops halves whose interval bound is
+         * above the best value found. Halves where the function is undefined are dropped as well.
+         */
+        inline std::optional<Extremum> minimize(const Expression& function, const double a, const double b,
+                                                const double sign, const ExtremumOptions& options) {
+            if (b < a) {
+                return minimize(function, b, a, sign, options);
+            }
+            const Program program = compile(function);
+            const double min_width = (b - a) * options.resolution;
+            const std::size_t initial = std::max<std::size_t>(1, options.initial_intervals);
+            Extremum best{0.0, std::numeric_limits<double>::infinity(), 0.0, 0};
+            const auto bound = [&](const double lo, const double hi) {
+                const Interval range = function.evaluate_interval({lo, hi});
+                if (range.domain == Domain::Outside) {
+                    return std::numeric_limits<double>::quiet_NaN();
+                }
+                return sign > 0 ? range.lo : -range.hi;
+            };
+
+            std::vector<double> xs;
+            std::vector<double> ys;
+            const auto sample = [&] {
+                ys.resize(xs.size());
+                program.evaluate_batch(xs, ys);
+                best.evaluations += xs.size();
+                for (std::size_t i = 0; i < xs.size(); ++i) {
+                    if (sign * ys[i] < best.y) {
+                        best.x = xs[i];
+                        best.y = sign * ys[i];
+                    }
+                }
+            };
+
+            std::vector<SearchInterval> live;
+            std::vector<SearchInterval> split;
+            std::vector<SearchInterval> narrow;
+            for (std::size_t i = 0; i < initial; ++i) {
+                const double lo = a + (b - a) * static_cast<double>(i) / static_cast<double>(initial);
+                const double hi = i + 1 == initial
+                                      ? b
+                                      : a + (b - a) * static_cast<double>(i + 1) / static_cast<double>(initial);
+                live.push_back({lo, hi, 0.0});
+                xs.push_back(lo + (hi - lo) / 2);
+            }
+            xs.push_back(a);
+            xs.push_back(b);
+            sample();
+            const auto keep = [&](std::vector<SearchInterval>& intervals) {
+                std::erase_if(intervals, [&](SearchInterval& i) {
+                    i.bound = bound(i.lo, i.hi);
+                    return std::isnan(i.bound) || i.bound > best.y - options.tolerance;
+                });
+            };
+            keep(live);
+
+            while (!live.empty()) {
+                // Intervals with the lowest bound are split first once the budget would be exceeded.
+                const std::size_t budget =
+                    (options.max_evaluations - std::min(options.max_evaluations, best.evaluations)) / 2;
+                if (budget == 0) {
+                    break;
+                }
+                if (live.size() > budget) {
+                    std::nth_element(live.begin(), live.begin() + static_cast<std::ptrdiff_t>(budget), live.end(),
+                                     [](const SearchInterval& x, const SearchInterval& y) {
+                                         return x.bound < y.bound;
+                                     });
+                    narrow.insert(narrow.end(), live.begin() + static_cast<std::ptrdiff_t>(budget), live.end());
+                    live.resize(budget);
+                }
+                split.clear();
+                xs.clear();
+                for (const SearchInterval& i : live) {
+                    const double mid = i.lo + (i.hi - i.lo) / 2;
+                    for (const SearchInterval half : {SearchInterval{i.lo, mid, 0.0},
+                                                      SearchInterval{mid, i.hi, 0.0}}) {
+                        split.push_back(half);
+                        xs.push_back(half.lo + (half.hi - half.lo) / 2);
+                    }
+                }
+                sample();
+                keep(split);
+                keep(narrow);
+                live.clear();
+                for (const SearchInterval& i : split) {
+                    (i.hi - i.lo <= min_width ? narrow : live).push_back(i);
+                }
+            }
+
+            if (!std::isfinite(best.y)) {
+                return std::nullopt;
+            }
+            narrow.insert(narrow.end(), live.begin(), live.end());
+            keep(narrow);
+            for (const SearchInterval& i : narrow) {
+                best.error = std::max(best.error, best.y - i.bound);
+            }
+            best.error = std::max(best.error, 0.0);
+            best.y *= sign;
+            return best;
+        }
+    } // namespace az::detail
+
+    /**
+     * Integral of function of x over [a, b] by adaptive Gauss-Kronrod quadrature. Each step splits the
+     * intervals with the largest error estimate and evaluates the 15-point rules of all halves in one batch,
+     * until the total error is within tolerance. Parts of the range where the function is NaN are located
+     * down to resolution and excluded; their width is reported as undefined.
+     */
+    [[nodiscard]] inline Integral integrate(const Expression& function, const double a, const double b,
+                                            const IntegrationOptions& options = {}) {
+        Integral result;
+        if (!(a < b)) {
+            result.converged = a == b;
+            return result;
+        }
+        const Program program = compile(function);
+        const double min_width = (b - a) * options.resolution;
+        const std::size_t initial = std::max<std::size_t>(1, options.initial_intervals);
+        std::vector<detail::QuadratureInterval> intervals;
+        std::vector<double> xs;
+        std::vector<double> ys;
+        std::vector<std::pair<double, double>> pending;
+        for (std::size_t i = 0; i < initial; ++i) {
+            const double lo = a + (b - a) * static_cast<double>(i) / static_cast<double>(initial);
+            const double hi = i + 1 == initial
+                                  ? b
+                                  : a + (b - a) * static_cast<double>(i + 1) / static_cast<double>(initial);
+            pending.emplace_back(lo, hi);
+        }
+
+        std::vector<std::size_t> refine;
+        for (;;) {
+            xs.clear();
+            for (const auto& [lo, hi] : pending) {
+                detail::kronrod_abscissae(lo, hi, xs);
+            }
+            ys.resize(xs.size());
+            program.evaluate_batch(xs, ys);
+            result.evaluations += xs.size();
+            for (std::size_t n = 0; n < pending.size(); ++n) {
+                intervals.push_back(detail::kronrod(function, pending[n].first, pending[n].second,
+                                                    ys.data() + n * detail::kronrod_points, min_width,
+                                                    result.undefined));
+            }
+            pending.clear();
+
+            result.value = 0.0;
+            result.error = 0.0;
+            refine.clear();
+            for (std::size_t i = 0; i < intervals.size(); ++i) {
+                result.value += intervals[i].value;
+                result.error += intervals[i].error;
+                if (!intervals[i].last && intervals[i].error > 0) {
+                    refine.push_back(i);
+                }
+            }
+            result.converged = result.error <= std::max(options.absolute_tolerance,
+                                                        options.tolerance * std::abs(result.value));
+            const std::size_t budget =
+                (options.max_evaluations - std::min(options.max_evaluations, result.evaluations))
+                / (2 * detail::kronrod_points);
+            const std::size_t count = std::min({refine.size(), options.batch, budget});
+            if (result.converged || count == 0) {
+                break;
+            }
+            std::nth_element(refine.begin(), refine.begin() + static_cast<std::ptrdiff_t>(count - 1), refine.end(),
+                             [&](const std::size_t x, const std::size_t y) {
+                                 return intervals[x].error > intervals[y].error;
+                             });
+            refine.resize(count);
+            std::sort(refine.begin(), refine.end(), std::greater<>());
+            for (const std::size_t i : refine) {
+                const double lo = intervals[i].lo;
+                const double hi = intervals[i].hi;
+                const double mid = lo + (hi - lo) / 2;
+                pending.emplace_back(lo, mid);
+                pending.emplace_back(mid, hi);
+                intervals[i] = intervals.back();
+                intervals.pop_back();
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Root of function of x in [a, b] by Brent's method, if the function has values of opposite signs, or
+     * zero, at a and b. Returns std::nullopt otherwise, or if the sign changes at a pole or across a part of
+     * the range where the function is NaN. Bounds given as b < a are swapped.
+     */
+    [[nodiscard]] inline std::optional<double> find_root(const Expression& function, const double a, const double b,
+                                                         const RootOptions& options = {}) {
+        if (b < a) {
+            return find_root(function, b, a, options);
+        }
+        const Program program = compile(function);
+        const double fa = program.evaluate(a);
+        const double fb = program.evaluate(b);
+        if (fa == 0 || fb == 0) {
+            return fa == 0 ? a : b;
+        }
+        if (std::isnan(fa) || std::isnan(fb) || (fa > 0) == (fb > 0)) {
+            return std::nullopt;
+        }
+        const std::vector<double> roots = detail::solve_brackets(function, program, {{a, b, fa, fb}}, options);
+        return roots.empty() ? std::nullopt : std::optional(roots.front());
+    }
+
+    /**
+     * Roots of function of x in [a, b] where its sign changes, in increasing order. The range is scanned at
+     * evenly spaced points in one batch and Brent's method then runs on all brackets found, evaluating their
+     * next points together. Roots closer than the spacing of the scan, or where the function touches zero
+     * without changing sign, may be missed. Bounds given as b < a are swapped.
+     */
+    [[nodiscard]] inline std::vector<double> find_roots(const Expression& function, const double a, const double b,
+                                                        const RootOptions& options = {}) {
+        if (b < a) {
+            return find_roots(function, b, a, options);
+        }
+        const Program program = compile(function);
+        const std::size_t points = std::max<std::size_t>(2, options.initial_points);
+        std::vector<double> xs(points);
+        std::vector<double> ys(points);
+        for (std::size_t i = 0; i < points; ++i) {
+            xs[i] = i + 1 == points ? b : a + (b - a) * static_cast<double>(i) / static_cast<double>(points - 1);
+        }
+        program.evaluate_batch(xs, ys);
+
+        std::vector<double> roots;
+        std::vector<detail::BrentBracket> brackets;
+        for (std::size_t i = 0; i < points; ++i) {
+            if (ys[i] == 0) {
+                roots.push_back(xs[i]);
+            } else if (i + 1 < points && ys[i + 1] != 0 && !std::isnan(ys[i]) && !std::isnan(ys[i + 1])
+                       && (ys[i] > 0) != (ys[i + 1] > 0)) {
+                brackets.emplace_back(xs[i], xs[i + 1], ys[i], ys[i + 1]);
+            }
+        }
+        const std::vector<double> found = detail::solve_brackets(function, program, std::move(brackets), options);
+        roots.insert(roots.end(), found.begin(), found.end());
+        std::sort(roots.begin(), roots.end());
+        return roots;
+    }
+
+    /**
+     * Global minimum of function of x over [a, b], located by branch and bound with interval evaluation.
+     * Returns std::nullopt if the function is NaN at every point sampled. Bounds given as b < a are swapped.
+     */
+    [[nodiscard]] inline std::optional<Extremum> minimize(const Expression& function, const double a, const double b,
+                                                          const ExtremumOptions& options = {}) {
+        return detail::minimize(function, a, b, 1.0, options);
+    }
+
+    /**
+     * Global maximum of function of x over [a, b], see minimize.
+     */
+    [[nodiscard]] inline std::optional<Extremum> maximize(const Expression& function, const double a, const double b,
+                                                          const ExtremumOptions& options = {}) {
+        return detail::minimize(function, a, b, -1.0, options);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_NUMERICS_HPP
@@ -0,0 +1,201 @@
+#ifndef FUNCTION_PARSER_PARALLEL_HPP
+#define FUNCTION_PARSER_PARALLEL_HPP
+
+#include "program.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace az {
+    /**
+     * Fixed set of worker threads running one parallel loop at a time. Iterations are handed out in
+     * chunks of grain elements from a shared counter, so threads that finish early keep taking work
+     * from the slower ones. The calling thread takes part in the loop as well.
+     */
+    class ThreadPool {
+    public:
+        explicit ThreadPool(const unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+            for (unsigned i = 1; i < threads; ++i) {
+                workers_.emplace_back([this] {
+                    current_ = this;
+                    work();
+                });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                const std::lock_guard lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto& worker: workers_) {
+                worker.join();
+            }
+        }
+
+        /**
+         * Number of threads taking part in a loop, including the caller.
+         */
+        [[nodiscard]] unsigned size() const {
+            return static_cast<unsigned>(workers_.size()) + 1;
+        }
+
+        /**
+         * Calls body(begin, end) for consecutive chunks of [0, count) and returns once all of them are done.
+         * If body throws, no more chunks are started and the first exception is rethrown once running
+         * chunks are done. Called from inside a body running on this pool, the loop runs on the calling
+         * thread alone.
+         */
+        void parallel_for(const std::size_t count, const std::size_t grain,
+                          const std::function<void(std::size_t, std::size_t)>& body) {
+            if (count == 0) {
+                return;
+            }
+            if (current_ == this) {
+                for (std::size_t begin = 0; begin < count; begin += std::max<std::size_t>(grain, 1)) {
+                    body(begin, std::min(begin + std::max<std::size_t>(grain, 1), count));
+                }
+                return;
+            }
+            const std::lock_guard submit(submit_);
+            {
+                const std::lock_guard lock(mutex_);
+                body_ = &body;
+                count_ = count;
+                grain_ = std::max<std::size_t>(grain, 1);
+                next_.store(0, std::memory_order_relaxed);
+                busy_ = static_cast<unsigned>(workers_.size());
+                ++generation_;
+            }
+            wake_.notify_all();
+            const ThreadPool* const outer = std::exchange(current_, this);
+            run();
+            current_ = outer;
+
+            std::unique_lock lock(mutex_);
+            done_.wait(lock, [this] { return busy_ == 0; });
+            body_ = nullptr;
+            if (error_) {
+                std::rethrow_exception(std::exchange(error_, nullptr));
+            }
+        }
+
+    private:
+        void run() {
+            for (;;) {
+                const std::size_t begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+                if (begin >= count_) {
+                    return;
+                }
+                try {
+                    (*body_)(begin, std::min(begin + grain_, count_));
+                } catch (...) {
+                    const std::lock_guard lock(mutex_);
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                    next_.store(count_, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        void work() {
+            std::uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock lock(mutex_);
+                    wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                    if (stop_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+                run();
+                {
+                    const std::lock_guard lock(mutex_);
+                    --busy_;
+                }
+                done_.notify_one();
+            }
+        }
+
+        std::vector<std::thread> workers_;
+        std::mutex submit_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        const std::function<void(std::size_t, std::size_t)>* body_ = nullptr;
+        std::size_t count_ = 0;
+        std::size_t grain_ = 1;
+        std::atomic<std::size_t> next_ = 0;
+        unsigned busy_ = 0;
+        std::uint64_t generation_ = 0;
+        std::exception_ptr error_;
+        bool stop_ = false;
+
+        // Pool whose loop the thread is running, to run nested loops inline instead of waiting for itself.
+        static inline thread_local const ThreadPool* current_ = nullptr;
+    };
+
+    /**
+     * Pool shared by parallel evaluations that do not specify their own one.
+     */
+    inline ThreadPool& default_thread_pool() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    struct ParallelOptions {
+        /// Number of arguments evaluated by one thread at a time.
+        std::size_t grain = 16384;
+        /// Pool running the evaluation, default_thread_pool() if not set.
+        ThreadPool* pool = nullptr;
+    };
+
+    /**
+     * Evaluates program for every value of xs across threads of the pool. Results are stored in out in
+     * the order of xs; out must be at least as long as xs.
+     */
+    inline void evaluate_parallel(const Program& program, const std::span<const double> xs, const std::span<double> out,
+                                  const ParallelOptions& options = {}) {
+        assert(out.size() >= xs.size());
+        ThreadPool& pool = options.pool ? *options.pool : default_thread_pool();
+        pool.parallel_for(xs.size(), options.grain, [&](const std::size_t begin, const std::size_t end) {
+            program.evaluate_batch(xs.subspan(begin, end - begin), out.subspan(begin, end - begin));
+        });
+    }
+
+    /**
+     * Evaluates program at out.size() evenly spaced points of [from, to], both ends included.
+     */
+    inline void evaluate_parallel(const Program& program, const double from, const double to,
+                                  const std::span<double> out, const ParallelOptions& options = {}) {
+        const double step = out.size() > 1 ? (to - from) / static_cast<double>(out.size() - 1) : 0.0;
+        ThreadPool& pool = options.pool ? *options.pool : default_thread_pool();
+        pool.parallel_for(out.size(), options.grain, [&](const std::size_t begin, const std::size_t end) {
+            std::vector<double> xs(end - begin);
+            for (std::size_t i = begin; i < end; ++i) {
+                xs[i - begin] = from + step * static_cast<double>(i);
+            }
+            program.evaluate_batch(xs, out.subspan(begin, end - begin));
+        });
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_PARALLEL_HPP
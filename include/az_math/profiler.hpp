@@ -0,0 +1,219 @@
+#ifndef FUNCTION_PARSER_PROFILER_HPP
+#define FUNCTION_PARSER_PROFILER_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+#include "tree.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AZ_MATH_RDTSC 1
+#endif
+
+namespace az {
+    /**
+     * Why an instruction produced NaN from operands that were not NaN.
+     */
+    enum class NanReason : std::uint8_t {
+        /// Variable value passed to evaluate was NaN.
+        NanArgument,
+        /// Constant is NaN, e.g. folded 1/0 or sqrt(-1).
+        NanConstant,
+        /// Division by number of magnitude at most domain_epsilon<double>.
+        DivisionByZero,
+        NegativeSqrt,
+        NonPositiveLogarithm,
+        /// Cotangent where sine is near zero.
+        CotangentPole,
+        ArcsinDomain,
+        ArccosDomain,
+        /// Negative base with non-integer exponent.
+        PowDomain,
+        /// Trigonometric function of an infinite value.
+        InfiniteArgument,
+        /// inf - inf, 0 * inf and similar.
+        InvalidArithmetic
+    };
+
+    [[nodiscard]] constexpr std::string_view to_string(const NanReason reason) {
+        switch (reason) {
+            case NanReason::NanArgument: return "nan_argument";
+            case NanReason::NanConstant: return "nan_constant";
+            case NanReason::DivisionByZero: return "division_by_zero";
+            case NanReason::NegativeSqrt: return "negative_sqrt";
+            case NanReason::NonPositiveLogarithm: return "non_positive_logarithm";
+            case NanReason::CotangentPole: return "cotangent_pole";
+            case NanReason::ArcsinDomain: return "arcsin_domain";
+            case NanReason::ArccosDomain: return "arccos_domain";
+            case NanReason::PowDomain: return "pow_domain";
+            case NanReason::InfiniteArgument: return "infinite_argument";
+            case NanReason::InvalidArithmetic: return "invalid_arithmetic";
+        }
+        return "unknown";
+    }
+
+    struct InstructionProfile {
+        Kind op;
+        std::uint64_t calls = 0;
+        /// Time spent in the instruction, in CPU timestamp counter cycles (nanoseconds where unavailable).
+        std::uint64_t ticks = 0;
+    };
+
+    /**
+     * Instruction where NaN appeared first. Operands are the values it was applied to, arguments the
+     * variable values of that evaluation.
+     */
+    struct NanOrigin {
+        std::size_t instruction;
+        Kind op;
+        NanReason reason;
+        double lhs;
+        double rhs;
+        std::uint64_t evaluation;
+        std::vector<double> arguments;
+    };
+
+    struct ProfileReport {
+        std::uint64_t evaluations = 0;
+        /// One entry per instruction of the profiled Program, in the same order.
+        std::vector<InstructionProfile> instructions;
+        std::optional<NanOrigin> first_nan;
+
+        /**
+         * Calls and ticks summed over instructions of the same kind.
+         */
+        [[nodiscard]] std::vector<InstructionProfile> by_kind() const {
+            std::vector<InstructionProfile> result;
+            for (const InstructionProfile& i : instructions) {
+                auto it = result.begin();
+                while (it != result.end() && it->op != i.op) ++it;
+                if (it == result.end()) {
+                    result.push_back({i.op});
+                    it = result.end() - 1;
+                }
+                it->calls += i.calls;
+                it->ticks += i.ticks;
+            }
+            return result;
+        }
+    };
+
+    namespace detail {
+        inline std::uint64_t ticks() {
+#ifdef AZ_MATH_RDTSC
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        inline NanReason nan_reason(const Kind op, const double l, const double r) {
+            switch (op) {
+                case Kind::Number: return NanReason::NanConstant;
+                case Kind::X:
+                case Kind::Variable: return NanReason::NanArgument;
+                case Kind::Div:
+                    return std::abs(r) <= domain_epsilon<double> ? NanReason::DivisionByZero
+                                                                 : NanReason::InvalidArithmetic;
+                case Kind::Sqrt: return NanReason::NegativeSqrt;
+                case Kind::Ln:
+                case Kind::Lg:
+                case Kind::Log: return NanReason::NonPositiveLogarithm;
+                case Kind::Cot: return std::isinf(l) ? NanReason::InfiniteArgument : NanReason::CotangentPole;
+                case Kind::Arcsin: return NanReason::ArcsinDomain;
+                case Kind::Arccos: return NanReason::ArccosDomain;
+                case Kind::Pow: return l < 0 && std::isfinite(r) ? NanReason::PowDomain : NanReason::InvalidArithmetic;
+                case Kind::Sin:
+                case Kind::Cos:
+                case Kind::Tan: return NanReason::InfiniteArgument;
+                default: return NanReason::InvalidArithmetic;
+            }
+        }
+    } // namespace az::detail
+
+    /**
+     * Instrumented evaluation of a Program. Every instruction is timed and counted, and the first
+     * instruction turning non-NaN operands into NaN is recorded with the reason. Profiling is opt-in:
+     * Program::evaluate itself is not instrumented and costs nothing extra.
+     */
+    class Profiler {
+    public:
+        explicit Profiler(Program program) : program_(std::move(program)) {
+            reset();
+        }
+
+        double evaluate(const double x) {
+            return evaluate(std::span<const double>(&x, 1));
+        }
+
+        double evaluate(const std::span<const double> variables) {
+            const auto code = program_.instructions();
+            registers_.resize(program_.registers());
+            double* r = registers_.data();
+            for (std::size_t n = 0; n < code.size(); ++n) {
+                const Instruction& i = code[n];
+                const std::uint64_t start = detail::ticks();
+                double l = 0.0;
+                double rhs = 0.0;
+                double result;
+                switch (i.op) {
+                    case Kind::Number: result = i.value; break;
+                    case Kind::X: result = variables[0]; break;
+                    case Kind::Variable: result = variables[i.lhs]; break;
+                    default:
+                        l = r[i.lhs];
+                        if (is_binary(i.op)) {
+                            rhs = r[i.rhs];
+                            result = apply(i.op, l, rhs);
+                        } else {
+                            result = apply(i.op, l);
+                        }
+                        break;
+                }
+                r[i.dst] = result;
+                InstructionProfile& p = report_.instructions[n];
+                p.ticks += detail::ticks() - start;
+                ++p.calls;
+
+                if (std::isnan(result) && !report_.first_nan && !std::isnan(l) && !std::isnan(rhs)) {
+                    report_.first_nan = NanOrigin{
+                        n, i.op, detail::nan_reason(i.op, l, rhs), l, rhs, report_.evaluations,
+                        std::vector<double>(variables.begin(), variables.end())
+                    };
+                }
+            }
+            ++report_.evaluations;
+            return code.empty() ? std::numeric_limits<double>::quiet_NaN() : r[code.back().dst];
+        }
+
+        [[nodiscard]] const ProfileReport& report() const { return report_; }
+
+        [[nodiscard]] const Program& program() const { return program_; }
+
+        void reset() {
+            report_ = {};
+            for (const Instruction& i : program_.instructions()) {
+                report_.instructions.push_back({i.op});
+            }
+        }
+
+    private:
+        Program program_;
+        std::vector<double> registers_;
+        ProfileReport report_;
+    };
+} // namespace az
+
+#endif //FUNCTION_PARSER_PROFILER_HPP
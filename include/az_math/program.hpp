@@ -0,0 +1,361 @@
+#ifndef FUNCTION_PARSER_PROGRAM_HPP
+#define FUNCTION_PARSER_PROGRAM_HPP
+
+#include "function_parser.hpp"
+#include "kernels.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace az {
+    /**
+     * Single step of a compiled expression. Instruction reads registers lhs (and rhs for binary
+     * operations) and writes its result into register dst. Number instructions load value,
+     * X instructions load the argument, Variable instructions load the variable in slot lhs.
+     */
+    struct Instruction {
+        Kind op;
+        std::uint32_t dst;
+        std::uint32_t lhs;
+        std::uint32_t rhs;
+        double value;
+    };
+
+    /**
+     * How evaluation treats operands outside of the domain of an operation. Strict is the behavior of
+     * the tree: division by and cotangent of numbers within 1e-10 of zero, logarithms of zero and
+     * similar give NaN. Fast leaves it to the hardware, without any branches: x/0 and ln(0) become
+     * infinities, pow(1, NaN) is 1, and NaN only appears where IEEE 754 produces it.
+     */
+    enum class NanPolicy : std::uint8_t {
+        Strict,
+        Fast
+    };
+
+    namespace detail {
+        template<NanPolicy P, typename Node, typename... Operands>
+        auto apply(const Operands... operands) {
+            if constexpr (P == NanPolicy::Strict) {
+                return Node::apply(operands...);
+            } else {
+                return Node::fast(operands...);
+            }
+        }
+
+        /**
+         * Runs non-empty program and returns value of its last instruction.
+         */
+        template<NanPolicy P = NanPolicy::Strict, std::floating_point T>
+        T run(const std::span<const Instruction> code, T* r, const T* variables) {
+            assert(!code.empty());
+            for (const Instruction& i : code) {
+                switch (i.op) {
+                    case Kind::Number: r[i.dst] = static_cast<T>(i.value); break;
+                    case Kind::X: r[i.dst] = variables[0]; break;
+                    case Kind::Variable: r[i.dst] = variables[i.lhs]; break;
+                    case Kind::Sin: r[i.dst] = apply<P, Sin>(r[i.lhs]); break;
+                    case Kind::Cos: r[i.dst] = apply<P, Cos>(r[i.lhs]); break;
+                    case Kind::Tan: r[i.dst] = apply<P, Tan>(r[i.lhs]); break;
+                    case Kind::Cot: r[i.dst] = apply<P, Cot>(r[i.lhs]); break;
+                    case Kind::Sqrt: r[i.dst] = apply<P, Sqrt>(r[i.lhs]); break;
+                    case Kind::Cbrt: r[i.dst] = apply<P, Cbrt>(r[i.lhs]); break;
+                    case Kind::Ln: r[i.dst] = apply<P, Ln>(r[i.lhs]); break;
+                    case Kind::Lg: r[i.dst] = apply<P, Lg>(r[i.lhs]); break;
+                    case Kind::Log: r[i.dst] = apply<P, Log>(r[i.lhs]); break;
+                    case Kind::Arcsin: r[i.dst] = apply<P, Arcsin>(r[i.lhs]); break;
+                    case Kind::Arccos: r[i.dst] = apply<P, Arccos>(r[i.lhs]); break;
+                    case Kind::Arctan: r[i.dst] = apply<P, Arctan>(r[i.lhs]); break;
+                    case Kind::Negative: r[i.dst] = apply<P, Negative>(r[i.lhs]); break;
+                    case Kind::Pow: r[i.dst] = apply<P, Pow>(r[i.lhs], r[i.rhs]); break;
+                    case Kind::Mul: r[i.dst] = apply<P, Mul>(r[i.lhs], r[i.rhs]); break;
+                    case Kind::Div: r[i.dst] = apply<P, Div>(r[i.lhs], r[i.rhs]); break;
+                    case Kind::Plus: r[i.dst] = apply<P, Plus>(r[i.lhs], r[i.rhs]); break;
+                    case Kind::Minus: r[i.dst] = apply<P, Minus>(r[i.lhs], r[i.rhs]); break;
+                }
+            }
+            return r[code.back().dst];
+        }
+
+        /**
+         * Runs program over n <= block_size arguments. Register i occupies r[i * block_size, (i + 1) * block_size),
+         * columns[s] points to n values of the variable in slot s.
+         */
+        template<NanPolicy P = NanPolicy::Strict, std::floating_point T>
+        void run_block(const std::span<const Instruction> code, T* r, const T* const* columns, const std::size_t n) {
+            const BasicKernels<T>& k = kernels<T>();
+            for (const Instruction& i : code) {
+                T* dst = r + i.dst * block_size;
+                const T* l = r + i.lhs * block_size;
+                const T* rhs = r + i.rhs * block_size;
+                switch (i.op) {
+                    case Kind::Number: std::fill_n(dst, n, static_cast<T>(i.value)); break;
+                    case Kind::X: std::copy_n(columns[0], n, dst); break;
+                    case Kind::Variable: std::copy_n(columns[i.lhs], n, dst); break;
+                    case Kind::Negative: k.negative(l, dst, n); break;
+                    case Kind::Sqrt: k.sqrt(l, dst, n); break;
+                    case Kind::Plus: k.plus(l, rhs, dst, n); break;
+                    case Kind::Minus: k.minus(l, rhs, dst, n); break;
+                    case Kind::Mul: k.mul(l, rhs, dst, n); break;
+                    case Kind::Div:
+                        if constexpr (P == NanPolicy::Strict) k.div(l, rhs, dst, n);
+                        else k.fast_div(l, rhs, dst, n);
+                        break;
+                    case Kind::Pow:
+                        for (std::size_t j = 0; j < n; ++j) dst[j] = apply<P, Pow>(l[j], rhs[j]);
+                        break;
+                    default:
+                        if constexpr (P == NanPolicy::Strict) transcendental(i.op, l, dst, n);
+                        else fast_transcendental(i.op, l, dst, n);
+                        break;
+                }
+            }
+        }
+    } // namespace az::detail
+
+    /**
+     * Expression lowered into a contiguous array of register instructions. Program gives the same
+     * results as the tree it was compiled from, but evaluates it in a single loop without virtual
+     * calls and pointer chasing. Every evaluate method takes a NanPolicy, Strict by default:
+     *
+     * program.evaluate<az::NanPolicy::Fast>(x);
+     *
+     * Evaluation runs in scalar type T. Constants are rounded to T when loaded, domain checks use the
+     * domain_epsilon of T. Program is BasicProgram<double>, other types are converted from it:
+     *
+     * az::BasicProgram<float> program(az::compile(*tree));
+     */
+    template<std::floating_point T>
+    class BasicProgram {
+    public:
+        using value_type = T;
+
+        static constexpr std::uint32_t inline_registers = 64;
+
+        /**
+         * Empty program, evaluating to NaN.
+         */
+        BasicProgram() = default;
+
+        BasicProgram(std::vector<Instruction> code, const std::uint32_t registers)
+            : code_(std::move(code)), registers_(registers) {
+            assert(!code_.empty() && registers_ > 0);
+            for (const Instruction& i : code_) {
+                if (i.op == Kind::X) {
+                    variables_ = std::max<std::uint32_t>(variables_, 1);
+                } else if (i.op == Kind::Variable) {
+                    variables_ = std::max(variables_, i.lhs + 1);
+                }
+            }
+        }
+
+        template<std::floating_point U>
+        explicit BasicProgram(const BasicProgram<U>& other)
+            : code_(other.instructions().begin(), other.instructions().end()), registers_(other.registers()),
+              variables_(other.variables()) {}
+
+        /**
+         * Evaluates program of at most one variable, x being the value of slot 0.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        [[nodiscard]] T evaluate(const T x) const {
+            assert(variables_ <= 1);
+            return evaluate<P>(std::span<const T>(&x, 1));
+        }
+
+        /**
+         * Evaluates program with variables[i] as the value of slot i; variables must hold at least
+         * variables() values.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        [[nodiscard]] T evaluate(const std::span<const T> variables) const {
+            assert(variables.size() >= variables_);
+            if (code_.empty()) {
+                return std::numeric_limits<T>::quiet_NaN();
+            }
+            if (registers_ <= inline_registers) {
+                std::array<T, inline_registers> r;
+                return detail::run<P>(code_, r.data(), variables.data());
+            }
+            std::vector<T> r(registers_);
+            return detail::run<P>(code_, r.data(), variables.data());
+        }
+
+        /**
+         * Evaluates program for every value of xs and stores results in out, which must be at least as long
+         * as xs. Each instruction is applied to a whole block of arguments at once with SIMD kernels chosen
+         * for the running CPU.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate_batch(const std::span<const T> xs, const std::span<T> out) const {
+            assert(variables_ <= 1);
+            assert(out.size() >= xs.size());
+            const std::span<const T> columns[] = {xs};
+            evaluate_batch<P>(columns, out.first(xs.size()));
+        }
+
+        /**
+         * Evaluates program for out.size() sets of variables given as structure of arrays: variables[s][j] is
+         * the value of slot s in the j-th set. There must be at least variables() arrays, each at least as long
+         * as out.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate_batch(const std::span<const std::span<const T>> variables, const std::span<T> out) const {
+            assert(variables.size() >= variables_);
+            if (code_.empty()) {
+                std::fill(out.begin(), out.end(), std::numeric_limits<T>::quiet_NaN());
+                return;
+            }
+            std::vector<T> r(static_cast<std::size_t>(registers_) * detail::block_size);
+            std::vector<const T*> columns(variables.size());
+            const T* result = r.data() + code_.back().dst * detail::block_size;
+            for (std::size_t begin = 0; begin < out.size(); begin += detail::block_size) {
+                const std::size_t n = std::min(detail::block_size, out.size() - begin);
+                for (std::size_t s = 0; s < variables.size(); ++s) {
+                    assert(variables[s].size() >= out.size());
+                    columns[s] = variables[s].data() + begin;
+                }
+                detail::run_block<P>(code_, r.data(), columns.data(), n);
+                std::copy_n(result, n, out.data() + begin);
+            }
+        }
+
+        [[nodiscard]] std::span<const Instruction> instructions() const { return code_; }
+
+        [[nodiscard]] std::uint32_t registers() const { return registers_; }
+
+        /**
+         * Number of variable slots the program reads: highest used slot plus one.
+         */
+        [[nodiscard]] std::uint32_t variables() const { return variables_; }
+
+        [[nodiscard]] bool empty() const { return code_.empty(); }
+
+    private:
+        std::vector<Instruction> code_;
+        std::uint32_t registers_ = 0;
+        std::uint32_t variables_ = 0;
+    };
+
+    using Program = BasicProgram<double>;
+
+    namespace detail {
+        /**
+         * Lowers any node representation providing kind(), children(node), number_value(node) and
+         * variable_slot(node).
+         */
+        template<typename Node>
+        class Compiler {
+        public:
+            explicit Compiler(const Node& root) {
+                count(root);
+            }
+
+            /**
+             * Prepares lowering of several roots into one program. Each root counts as one more use of its
+             * node, released by emit_root.
+             */
+            explicit Compiler(const std::span<const Node* const> roots) {
+                for (const Node* root : roots) {
+                    count(*root);
+                }
+            }
+
+            Program operator()(const Node& root) {
+                emit(root);
+                return {std::move(code_), registers_};
+            }
+
+            /**
+             * Emits one of the roots and returns the register holding its value after the instructions
+             * emitted so far. Instructions emitted later may reuse the register.
+             */
+            std::uint32_t emit_root(const Node& root) {
+                const std::uint32_t reg = emit(root);
+                release(root);
+                return reg;
+            }
+
+            [[nodiscard]] std::size_t size() const { return code_.size(); }
+
+            Program finish() {
+                if (code_.empty()) {
+                    return {};
+                }
+                return {std::move(code_), registers_};
+            }
+
+        private:
+            // Counts parents of every node, so registers of shared subtrees live until their last use.
+            void count(const Node& e) {
+                if (uses_[&e]++ > 0) {
+                    return;
+                }
+                const auto [l, r] = children(e);
+                if (l) count(*l);
+                if (r) count(*r);
+            }
+
+            void release(const Node& e) {
+                if (--uses_[&e] == 0) {
+                    free_.push_back(emitted_[&e]);
+                }
+            }
+
+            std::uint32_t allocate() {
+                if (free_.empty()) {
+                    return registers_++;
+                }
+                const std::uint32_t reg = free_.back();
+                free_.pop_back();
+                return reg;
+            }
+
+            std::uint32_t emit(const Node& e) {
+                if (const auto it = emitted_.find(&e); it != emitted_.end()) {
+                    return it->second;
+                }
+
+                const auto [l, r] = children(e);
+                Instruction i{e.kind(), 0, 0, 0, 0.0};
+                if (e.kind() == Kind::Number) {
+                    i.value = number_value(e);
+                } else if (e.kind() == Kind::Variable) {
+                    i.lhs = variable_slot(e);
+                }
+                if (l) i.lhs = emit(*l);
+                if (r) i.rhs = emit(*r);
+                if (l) release(*l);
+                if (r) release(*r);
+
+                i.dst = allocate();
+                code_.push_back(i);
+                emitted_[&e] = i.dst;
+                return i.dst;
+            }
+
+            std::unordered_map<const Node*, std::uint32_t> uses_;
+            std::unordered_map<const Node*, std::uint32_t> emitted_;
+            std::vector<std::uint32_t> free_;
+            std::vector<Instruction> code_;
+            std::uint32_t registers_ = 0;
+        };
+    } // namespace az::detail
+
+    /**
+     * Lowers expression tree into Program. Nodes shared by several parents are computed once.
+     */
+    inline Program compile(const Expression& expression) {
+        return detail::Compiler<Expression>(expression)(expression);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_PROGRAM_HPP
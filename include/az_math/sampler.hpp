@@ -0,0 +1,216 @@
+#ifndef FUNCTION_PARSER_SAMPLER_HPP
+#define FUNCTION_PARSER_SAMPLER_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace az {
+    struct SamplerOptions {
+        /// Largest distance in y between the curve and the polyline, e.g. height of one pixel in units of y.
+        double tolerance = 1e-3;
+        /// Largest number of evaluations.
+        std::size_t max_points = 4096;
+        /// Evenly spaced points sampling starts from, at least 2.
+        std::size_t initial_points = 65;
+        /// Width, relative to the whole range, below which intervals are no longer split to locate poles and
+        /// edges of the domain.
+        double resolution = 1e-9;
+    };
+
+    struct SamplePoint {
+        double x;
+        double y;
+    };
+
+    struct Sampled {
+        /// Polylines in increasing x. Curve is split into several of them where it is NaN or has a pole.
+        std::vector<std::vector<SamplePoint>> segments;
+        std::size_t evaluations = 0;
+    };
+
+    namespace detail {
+        /// What interval evaluation tells about the function between two adjacent samples.
+        enum class Gap : std::uint8_t {
+            /// Defined and bounded.
+            None,
+            /// NaN everywhere.
+            Undefined,
+            /// May be NaN or unbounded somewhere.
+            Possible
+        };
+
+        struct Sample {
+            double x;
+            double y;
+            /// Gap between this sample and the next one.
+            Gap gap;
+        };
+
+        inline Gap gap(const Expression& function, const double lo, const double hi) {
+            const Interval i = function.evaluate_interval({lo, hi});
+            if (i.domain == Domain::Outside) {
+                return Gap::Undefined;
+            }
+            return i.domain == Domain::Inside && std::isfinite(i.lo) && std::isfinite(i.hi) ? Gap::None
+                                                                                           : Gap::Possible;
+        }
+
+        /**
+         * Whether the polyline may connect samples a and b, which are not NaN. It may not if the function can
+         * be NaN between them and leaves their range there by more than tolerance, as it does at a pole.
+         * NaN holes narrower than the samples' distance without such a jump are not visible in the polyline.
+         */
+        inline bool continuous(const Expression& function, const Sample& a, const Sample& b, const double tolerance) {
+            if (a.gap == Gap::None) {
+                return true;
+            }
+            const Interval i = function.evaluate_interval({a.x, b.x});
+            return i.domain != Domain::Outside && i.lo >= std::min(a.y, b.y) - tolerance
+                   && i.hi <= std::max(a.y, b.y) + tolerance;
+        }
+    } // namespace az::detail
+
+    /**
+     * Samples function of x on [lo, hi] for plotting or tabulation. Sampling starts from an even grid and
+     * then, in rounds, halves intervals where the polyline is further than tolerance from a sample, where
+     * NaN begins or ends, and where interval evaluation finds a possible pole or NaN between two samples.
+     * Poles and domain edges are located down to resolution before the curve is refined. Each round is
+     * evaluated as one batch of a compiled Program, intervals with the largest error first once max_points
+     * would be exceeded, so flat regions get only the initial points. The curve is split into separate
+     * segments at NaN and at poles. Bounds given as hi < lo are swapped.
+     */
+    [[nodiscard]] inline Sampled sample(const Expression& function, const double lo, const double hi,
+                                        const SamplerOptions& options = {}) {
+        if (hi < lo) {
+            return sample(function, hi, lo, options);
+        }
+        constexpr double infinity = std::numeric_limits<double>::infinity();
+        const Program program = compile(function);
+        const std::size_t initial = std::max<std::size_t>(2, std::min(options.initial_points, options.max_points));
+
+        std::vector<double> xs(initial);
+        std::vector<double> ys(initial);
+        for (std::size_t i = 0; i < initial; ++i) {
+            xs[i] = i + 1 == initial ? hi : lo + (hi - lo) * static_cast<double>(i) / static_cast<double>(initial - 1);
+        }
+        program.evaluate_batch(xs, ys);
+
+        Sampled result;
+        result.evaluations = initial;
+        std::vector<detail::Sample> samples(initial);
+        for (std::size_t i = 0; i < initial; ++i) {
+            samples[i] = {xs[i], ys[i], detail::Gap::None};
+            if (i > 0) {
+                samples[i - 1].gap = detail::gap(function, xs[i - 1], xs[i]);
+            }
+        }
+
+        const double min_width = (hi - lo) * options.resolution;
+        std::vector<double> priority;
+        std::vector<std::size_t> split;
+        std::vector<detail::Sample> refined;
+        while (result.evaluations < options.max_points) {
+            // Interval i between samples i and i + 1 is split if its priority is positive.
+            priority.assign(samples.size() - 1, 0.0);
+            const auto splittable = [&](const std::size_t i) {
+                const double mid = samples[i].x + (samples[i + 1].x - samples[i].x) / 2;
+                return samples[i + 1].x - samples[i].x > min_width && samples[i].x < mid && mid < samples[i + 1].x;
+            };
+            // Poles and edges of the domain are located first, then the curve is refined where it bends.
+            bool locating = false;
+            for (std::size_t i = 0; i + 1 < samples.size(); ++i) {
+                if (!splittable(i)) {
+                    continue;
+                }
+                const bool nan_left = std::isnan(samples[i].y);
+                const bool nan_right = std::isnan(samples[i + 1].y);
+                if (nan_left != nan_right || samples[i].gap == detail::Gap::Possible) {
+                    priority[i] = infinity;
+                    locating = true;
+                }
+            }
+            for (std::size_t i = 1; !locating && i + 1 < samples.size(); ++i) {
+                const detail::Sample& a = samples[i - 1];
+                const detail::Sample& b = samples[i];
+                const detail::Sample& c = samples[i + 1];
+                if (a.gap != detail::Gap::None || b.gap != detail::Gap::None
+                    || std::isnan(a.y) || std::isnan(b.y) || std::isnan(c.y)) {
+                    continue;
+                }
+                // Distance of b from the chord a-c is about four times the distance of the curve from a-b or
+                // b-c, which are the segments of the polyline.
+                const double chord = a.y + (c.y - a.y) * ((b.x - a.x) / (c.x - a.x));
+                const double error = std::abs(b.y - chord) / 4;
+                if (error > options.tolerance) {
+                    if (splittable(i - 1)) priority[i - 1] = std::max(priority[i - 1], error);
+                    if (splittable(i)) priority[i] = std::max(priority[i], error);
+                }
+            }
+
+            split.clear();
+            for (std::size_t i = 0; i < priority.size(); ++i) {
+                if (priority[i] > 0) {
+                    split.push_back(i);
+                }
+            }
+            if (split.empty()) {
+                break;
+            }
+            const std::size_t budget = options.max_points - result.evaluations;
+            if (split.size() > budget) {
+                std::nth_element(split.begin(), split.begin() + static_cast<std::ptrdiff_t>(budget), split.end(),
+                                 [&](const std::size_t a, const std::size_t b) { return priority[a] > priority[b]; });
+                split.resize(budget);
+                std::sort(split.begin(), split.end());
+            }
+
+            xs.resize(split.size());
+            ys.resize(split.size());
+            for (std::size_t n = 0; n < split.size(); ++n) {
+                xs[n] = samples[split[n]].x + (samples[split[n] + 1].x - samples[split[n]].x) / 2;
+            }
+            program.evaluate_batch(xs, ys);
+            result.evaluations += split.size();
+
+            refined.clear();
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < samples.size(); ++i) {
+                refined.push_back(samples[i]);
+                if (n == split.size() || split[n] != i) {
+                    continue;
+                }
+                detail::Sample mid{xs[n], ys[n], samples[i].gap};
+                // Parts of an interval without a gap have none either.
+                if (samples[i].gap != detail::Gap::None) {
+                    refined.back().gap = detail::gap(function, samples[i].x, mid.x);
+                    mid.gap = detail::gap(function, mid.x, samples[i + 1].x);
+                }
+                refined.push_back(mid);
+                ++n;
+            }
+            std::swap(samples, refined);
+        }
+
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            const detail::Sample& s = samples[i];
+            if (std::isnan(s.y)) {
+                continue;
+            }
+            if (i == 0 || std::isnan(samples[i - 1].y) || !detail::continuous(function, samples[i - 1], s, options.tolerance)) {
+                result.segments.emplace_back();
+            }
+            result.segments.back().push_back({s.x, s.y});
+        }
+        return result;
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_SAMPLER_HPP
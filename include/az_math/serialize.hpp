@@ -0,0 +1,393 @@
+#ifndef FUNCTION_PARSER_SERIALIZE_HPP
+#define FUNCTION_PARSER_SERIALIZE_HPP
+
+#include "function_parser.hpp"
+#include "program.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Binary format, all integers and doubles little-endian, version 1.
+ *
+ * Program record:
+ *   0   char[4]  magic "AZPR"
+ *   4   u16      version
+ *   6   u16      flags, 0
+ *   8   u32      instruction count n
+ *   12  u32      register count
+ *   16  u32      constant count c
+ *   20  u32      reserved, 0
+ *   24  n * 16   instructions: u8 kind, u8[3] reserved, u32 dst, u32 lhs, u32 rhs;
+ *                Number instructions keep index into constants in lhs, Variable ones the slot
+ *   ..  c * 8    constants, f64
+ *
+ * Catalog of many records:
+ *   0   char[4]  magic "AZCT"
+ *   4   u16      version
+ *   6   u16      flags, 0
+ *   8   u64      record count m
+ *   16  m * 16   index: u64 offset from the catalog start, u64 size; both 0 for an empty program
+ *   ..           records, each starting at a multiple of 8
+ *
+ * Records of Chebyshev approximations are described in serialize_chebyshev.hpp.
+ *
+ * Values of Kind are part of the format, new kinds may only be appended.
+ */
+
+namespace az {
+    namespace detail {
+        constexpr std::uint16_t format_version = 1;
+        constexpr std::size_t program_header_size = 24;
+        constexpr std::size_t instruction_size = 16;
+        constexpr std::size_t catalog_header_size = 16;
+        constexpr std::uint32_t max_registers = 1u << 20;
+        constexpr std::uint32_t max_variables = 1u << 16;
+        constexpr auto last_kind = static_cast<std::uint8_t>(Kind::Minus);
+
+        template<typename T>
+        T read(const std::byte* p) {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            if constexpr (std::endian::native == std::endian::big) {
+                auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+                std::reverse(bytes.begin(), bytes.end());
+                value = std::bit_cast<T>(bytes);
+            }
+            return value;
+        }
+
+        template<typename T>
+        void write(std::vector<std::byte>& out, const T value) {
+            auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+            if constexpr (std::endian::native == std::endian::big) {
+                std::reverse(bytes.begin(), bytes.end());
+            }
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        }
+
+        template<typename T>
+        void write_at(std::vector<std::byte>& out, const std::size_t offset, const T value) {
+            std::vector<std::byte> bytes;
+            write(bytes, value);
+            std::copy(bytes.begin(), bytes.end(), out.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        inline bool has_magic(const std::span<const std::byte> data, const char (&magic)[5]) {
+            return data.size() >= 4 && std::memcmp(data.data(), magic, 4) == 0;
+        }
+    } // namespace az::detail
+
+    /**
+     * Serialized program evaluated in place. It points into the buffer it was loaded from, which must
+     * outlive it; nothing is copied or parsed, instructions are decoded as they run.
+     */
+    class ProgramView {
+    public:
+        /**
+         * Empty view, evaluating to NaN like an empty Program.
+         */
+        ProgramView() = default;
+
+        /**
+         * Validates untrusted bytes of a program record. Returns std::nullopt if they are not a well-formed
+         * record of a supported version: wrong sizes, unknown kinds, more registers than instructions,
+         * registers out of range or read before being written.
+         */
+        static std::optional<ProgramView> load(const std::span<const std::byte> data) {
+            using namespace detail;
+            if (data.size() < program_header_size || !has_magic(data, "AZPR")
+                || read<std::uint16_t>(data.data() + 4) != format_version || read<std::uint16_t>(data.data() + 6) != 0
+                || read<std::uint32_t>(data.data() + 20) != 0) {
+                return std::nullopt;
+            }
+            ProgramView view;
+            view.size_ = read<std::uint32_t>(data.data() + 8);
+            view.registers_ = read<std::uint32_t>(data.data() + 12);
+            const std::uint32_t constants = read<std::uint32_t>(data.data() + 16);
+            // Every instruction writes at most one new register, so more registers than instructions only
+            // inflate the register file allocated by evaluate_batch.
+            if (view.size_ == 0 || view.registers_ == 0 || view.registers_ > max_registers
+                || view.registers_ > view.size_
+                || data.size() != program_header_size + std::uint64_t{view.size_} * instruction_size
+                                  + std::uint64_t{constants} * sizeof(double)) {
+                return std::nullopt;
+            }
+            view.code_ = data.data() + program_header_size;
+            view.constants_ = view.code_ + std::size_t{view.size_} * instruction_size;
+
+            std::vector<bool> written(view.registers_);
+            for (std::uint32_t n = 0; n < view.size_; ++n) {
+                const std::byte* p = view.code_ + std::size_t{n} * instruction_size;
+                const auto kind = static_cast<std::uint8_t>(p[0]);
+                if (kind > last_kind || p[1] != std::byte{0} || p[2] != std::byte{0} || p[3] != std::byte{0}) {
+                    return std::nullopt;
+                }
+                const Kind op = static_cast<Kind>(kind);
+                const auto dst = read<std::uint32_t>(p + 4);
+                const auto lhs = read<std::uint32_t>(p + 8);
+                const auto rhs = read<std::uint32_t>(p + 12);
+                bool valid = dst < view.registers_;
+                if (op == Kind::Number) {
+                    valid = valid && lhs < constants && rhs == 0;
+                } else if (op == Kind::X) {
+                    valid = valid && lhs == 0 && rhs == 0;
+                    view.variables_ = std::max<std::uint32_t>(view.variables_, 1);
+                } else if (op == Kind::Variable) {
+                    valid = valid && lhs < max_variables && rhs == 0;
+                    view.variables_ = std::max(view.variables_, lhs + 1);
+                } else if (is_binary(op)) {
+                    valid = valid && lhs < view.registers_ && written[lhs] && rhs < view.registers_ && written[rhs];
+                } else {
+                    valid = valid && lhs < view.registers_ && written[lhs] && rhs == 0;
+                }
+                if (!valid) {
+                    return std::nullopt;
+                }
+                written[dst] = true;
+                view.result_ = dst;
+            }
+            return view;
+        }
+
+        template<NanPolicy P = NanPolicy::Strict>
+        [[nodiscard]] double evaluate(const double x) const {
+            assert(variables_ <= 1);
+            return evaluate<P>(std::span<const double>(&x, 1));
+        }
+
+        template<NanPolicy P = NanPolicy::Strict>
+        [[nodiscard]] double evaluate(const std::span<const double> variables) const {
+            assert(variables.size() >= variables_);
+            if (size_ == 0) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            if (registers_ <= Program::inline_registers) {
+                std::array<double, Program::inline_registers> r;
+                return run<P>(r.data(), variables.data());
+            }
+            std::vector<double> r(registers_);
+            return run<P>(r.data(), variables.data());
+        }
+
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate_batch(const std::span<const double> xs, const std::span<double> out) const {
+            assert(variables_ <= 1);
+            assert(out.size() >= xs.size());
+            const std::span<const double> columns[] = {xs};
+            evaluate_batch<P>(columns, out.first(xs.size()));
+        }
+
+        /**
+         * Same as Program::evaluate_batch with one array per variable slot.
+         */
+        template<NanPolicy P = NanPolicy::Strict>
+        void evaluate_batch(const std::span<const std::span<const double>> variables,
+                            const std::span<double> out) const {
+            assert(variables.size() >= variables_);
+            if (size_ == 0) {
+                std::fill(out.begin(), out.end(), std::numeric_limits<double>::quiet_NaN());
+                return;
+            }
+            std::vector<double> r(static_cast<std::size_t>(registers_) * detail::block_size);
+            std::vector<const double*> columns(variables.size());
+            const double* result = r.data() + result_ * detail::block_size;
+            for (std::size_t begin = 0; begin < out.size(); begin += detail::block_size) {
+                const std::size_t n = std::min(detail::block_size, out.size() - begin);
+                for (std::size_t s = 0; s < variables.size(); ++s) {
+                    columns[s] = variables[s].data() + begin;
+                }
+                for (std::uint32_t k = 0; k < size_; ++k) {
+                    const Instruction i = instruction(k);
+                    detail::run_block<P>(std::span(&i, 1), r.data(), columns.data(), n);
+                }
+                std::copy_n(result, n, out.data() + begin);
+            }
+        }
+
+        [[nodiscard]] Instruction instruction(const std::uint32_t n) const {
+            const std::byte* p = code_ + std::size_t{n} * detail::instruction_size;
+            Instruction i{static_cast<Kind>(p[0]), detail::read<std::uint32_t>(p + 4),
+                          detail::read<std::uint32_t>(p + 8), detail::read<std::uint32_t>(p + 12), 0.0};
+            if (i.op == Kind::Number) {
+                i.value = detail::read<double>(constants_ + std::size_t{i.lhs} * sizeof(double));
+                i.lhs = 0;
+            }
+            return i;
+        }
+
+        /**
+         * Copies instructions into a Program, e.g. to translate it with JitFunction.
+         */
+        [[nodiscard]] Program to_program() const {
+            if (size_ == 0) {
+                return {};
+            }
+            std::vector<Instruction> code;
+            code.reserve(size_);
+            for (std::uint32_t n = 0; n < size_; ++n) {
+                code.push_back(instruction(n));
+            }
+            return {std::move(code), registers_};
+        }
+
+        [[nodiscard]] std::uint32_t size() const { return size_; }
+
+        [[nodiscard]] std::uint32_t registers() const { return registers_; }
+
+        [[nodiscard]] std::uint32_t variables() const { return variables_; }
+
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    private:
+
+        template<NanPolicy P>
+        double run(double* r, const double* variables) const {
+            for (std::uint32_t n = 0; n < size_; ++n) {
+                const Instruction i = instruction(n);
+                detail::run<P>(std::span(&i, 1), r, variables);
+            }
+            return r[result_];
+        }
+
+        const std::byte* code_ = nullptr;
+        const std::byte* constants_ = nullptr;
+        std::uint32_t size_ = 0;
+        std::uint32_t registers_ = 0;
+        std::uint32_t variables_ = 0;
+        std::uint32_t result_ = 0;
+    };
+
+    /**
+     * Serializes non-empty program into a record of the binary format. Equal constants are stored once.
+     */
+    inline std::vector<std::byte> save_program(const Program& program) {
+        assert(!program.empty());
+        std::vector<double> constants;
+        std::unordered_map<std::uint64_t, std::uint32_t> pool;
+        std::vector<std::byte> out;
+        out.reserve(detail::program_header_size + program.instructions().size() * detail::instruction_size);
+        out.insert(out.end(), {std::byte{'A'}, std::byte{'Z'}, std::byte{'P'}, std::byte{'R'}});
+        detail::write(out, detail::format_version);
+        detail::write(out, std::uint16_t{0});
+        detail::write(out, static_cast<std::uint32_t>(program.instructions().size()));
+        detail::write(out, program.registers());
+        detail::write(out, std::uint32_t{0});
+        detail::write(out, std::uint32_t{0});
+        for (const Instruction& i : program.instructions()) {
+            std::uint32_t lhs = i.lhs;
+            if (i.op == Kind::Number) {
+                const auto [it, added] = pool.emplace(std::bit_cast<std::uint64_t>(i.value),
+                                                      static_cast<std::uint32_t>(constants.size()));
+                if (added) {
+                    constants.push_back(i.value);
+                }
+                lhs = it->second;
+            }
+            out.insert(out.end(), {static_cast<std::byte>(i.op), std::byte{0}, std::byte{0}, std::byte{0}});
+            detail::write(out, i.dst);
+            detail::write(out, lhs);
+            detail::write(out, i.rhs);
+        }
+        for (const double c : constants) {
+            detail::write(out, c);
+        }
+        detail::write_at(out, 16, static_cast<std::uint32_t>(constants.size()));
+        return out;
+    }
+
+    inline std::vector<std::byte> save_program(const Expression& expression) {
+        return save_program(compile(expression));
+    }
+
+    /**
+     * Catalog of many serialized programs loaded in place. Every record is validated when the catalog is
+     * loaded, so accessing them afterwards needs no checks.
+     */
+    class CatalogView {
+    public:
+        static std::optional<CatalogView> load(const std::span<const std::byte> data) {
+            using namespace detail;
+            if (data.size() < catalog_header_size || !has_magic(data, "AZCT")
+                || read<std::uint16_t>(data.data() + 4) != format_version || read<std::uint16_t>(data.data() + 6) != 0) {
+                return std::nullopt;
+            }
+            const auto count = read<std::uint64_t>(data.data() + 8);
+            if (count > (data.size() - catalog_header_size) / 16) {
+                return std::nullopt;
+            }
+            CatalogView catalog;
+            catalog.programs_.reserve(count);
+            for (std::uint64_t n = 0; n < count; ++n) {
+                const std::byte* entry = data.data() + catalog_header_size + n * 16;
+                const auto offset = read<std::uint64_t>(entry);
+                const auto size = read<std::uint64_t>(entry + 8);
+                if (offset == 0 && size == 0) {
+                    catalog.programs_.emplace_back();
+                    continue;
+                }
+                if (offset % 8 != 0 || offset > data.size() || size > data.size() - offset) {
+                    return std::nullopt;
+                }
+                auto program = ProgramView::load(data.subspan(offset, size));
+                if (!program) {
+                    return std::nullopt;
+                }
+                catalog.programs_.push_back(*program);
+            }
+            return catalog;
+        }
+
+        [[nodiscard]] std::size_t size() const { return programs_.size(); }
+
+        [[nodiscard]] const ProgramView& operator[](const std::size_t i) const { return programs_[i]; }
+
+        [[nodiscard]] auto begin() const { return programs_.begin(); }
+
+        [[nodiscard]] auto end() const { return programs_.end(); }
+
+    private:
+        CatalogView() = default;
+
+        std::vector<ProgramView> programs_;
+    };
+
+    /**
+     * Serializes programs into a catalog with an offset index, in the given order. Empty programs, e.g.
+     * of invalid lines of load_expressions, have no record and are loaded back as empty views.
+     */
+    inline std::vector<std::byte> save_catalog(const std::span<const Program> programs) {
+        std::vector<std::byte> out;
+        out.insert(out.end(), {std::byte{'A'}, std::byte{'Z'}, std::byte{'C'}, std::byte{'T'}});
+        detail::write(out, detail::format_version);
+        detail::write(out, std::uint16_t{0});
+        detail::write(out, static_cast<std::uint64_t>(programs.size()));
+        out.resize(detail::catalog_header_size + programs.size() * 16);
+        for (std::size_t n = 0; n < programs.size(); ++n) {
+            if (programs[n].empty()) {
+                continue;
+            }
+            out.resize((out.size() + 7) / 8 * 8);
+            const std::vector<std::byte> record = save_program(programs[n]);
+            const std::size_t entry = detail::catalog_header_size + n * 16;
+            detail::write_at(out, entry, static_cast<std::uint64_t>(out.size()));
+            detail::write_at(out, entry + 8, static_cast<std::uint64_t>(record.size()));
+            out.insert(out.end(), record.begin(), record.end());
+        }
+        return out;
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_SERIALIZE_HPP
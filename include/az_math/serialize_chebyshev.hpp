@@ -0,0 +1,106 @@
+#ifndef FUNCTION_PARSER_SERIALIZE_CHEBYSHEV_HPP
+#define FUNCTION_PARSER_SERIALIZE_CHEBYSHEV_HPP
+
+#include "chebyshev.hpp"
+#include "serialize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+/*
+ * Piecewise Chebyshev approximation record, in the binary format of serialize.hpp:
+ *   0   char[4]  magic "AZCH"
+ *   4   u16      version
+ *   6   u16      flags, 0
+ *   8   u32      piece count p
+ *   12  u32      coefficient count c
+ *   16  f64      error estimate
+ *   24  (p+1)*8  breaks, f64, increasing
+ *   ..  c * 8    coefficients, f64
+ *   ..  (p+1)*4  offsets: u32, from 0 to c, non-decreasing; piece i has coefficients [offsets[i], offsets[i+1]),
+ *                none for gaps
+ */
+
+namespace az {
+    namespace detail {
+        constexpr std::size_t approximation_header_size = 24;
+    } // namespace az::detail
+
+    /**
+     * Serializes piece table of an approximation.
+     */
+    inline std::vector<std::byte> save_approximation(const Approximation& approximation) {
+        std::vector<std::byte> out;
+        out.reserve(detail::approximation_header_size + approximation.breaks().size() * 12
+                    + approximation.coefficients().size() * sizeof(double));
+        out.insert(out.end(), {std::byte{'A'}, std::byte{'Z'}, std::byte{'C'}, std::byte{'H'}});
+        detail::write(out, detail::format_version);
+        detail::write(out, std::uint16_t{0});
+        detail::write(out, static_cast<std::uint32_t>(approximation.size()));
+        detail::write(out, static_cast<std::uint32_t>(approximation.coefficients().size()));
+        detail::write(out, approximation.error());
+        for (const double b : approximation.breaks()) {
+            detail::write(out, b);
+        }
+        for (const double c : approximation.coefficients()) {
+            detail::write(out, c);
+        }
+        for (const std::uint32_t o : approximation.offsets()) {
+            detail::write(out, o);
+        }
+        return out;
+    }
+
+    /**
+     * Validates untrusted bytes of an approximation record and copies its piece table. Returns std::nullopt
+     * if they are not a well-formed record of a supported version: wrong sizes, breaks not finite and
+     * increasing or offsets out of order.
+     */
+    inline std::optional<Approximation> load_approximation(const std::span<const std::byte> data) {
+        using namespace detail;
+        if (data.size() < approximation_header_size || !has_magic(data, "AZCH")
+            || read<std::uint16_t>(data.data() + 4) != format_version || read<std::uint16_t>(data.data() + 6) != 0) {
+            return std::nullopt;
+        }
+        const auto pieces = read<std::uint32_t>(data.data() + 8);
+        const auto count = read<std::uint32_t>(data.data() + 12);
+        const auto error = read<double>(data.data() + 16);
+        if (pieces == 0 || !(error >= 0)
+            || data.size() != approximation_header_size + (std::uint64_t{pieces} + 1) * (sizeof(double) + 4)
+                              + std::uint64_t{count} * sizeof(double)) {
+            return std::nullopt;
+        }
+        const std::byte* p = data.data() + approximation_header_size;
+        std::vector<double> breaks(std::size_t{pieces} + 1);
+        for (double& b : breaks) {
+            b = read<double>(p);
+            p += sizeof(double);
+        }
+        std::vector<double> coefficients(count);
+        for (double& c : coefficients) {
+            c = read<double>(p);
+            p += sizeof(double);
+        }
+        std::vector<std::uint32_t> offsets(std::size_t{pieces} + 1);
+        for (std::uint32_t& o : offsets) {
+            o = read<std::uint32_t>(p);
+            p += 4;
+        }
+        if (!std::all_of(breaks.begin(), breaks.end(), [](const double b) { return std::isfinite(b); })
+            || std::adjacent_find(breaks.begin(), breaks.end(), std::greater_equal<>()) != breaks.end()
+            || offsets.front() != 0 || offsets.back() != count
+            || std::adjacent_find(offsets.begin(), offsets.end(), std::greater<>()) != offsets.end()) {
+            return std::nullopt;
+        }
+        return Approximation(std::move(breaks), std::move(offsets), std::move(coefficients), error);
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_SERIALIZE_CHEBYSHEV_HPP
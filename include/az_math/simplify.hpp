@@ -0,0 +1,138 @@
+#ifndef FUNCTION_PARSER_SIMPLIFY_HPP
+#define FUNCTION_PARSER_SIMPLIFY_HPP
+
+#include "function_parser.hpp"
+#include "tree.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace az {
+    namespace detail {
+        [[nodiscard]] inline bool is_number(const Expression& e, const double value) {
+            return e.kind() == Kind::Number && static_cast<const Number&>(e).value == value;
+        }
+
+        // Numbers go last, so constants end up on the right-hand side of commutative operations.
+        [[nodiscard]] inline int rank(const Kind kind) {
+            return kind == Kind::Number ? 256 : static_cast<int>(kind);
+        }
+
+        /**
+         * Total structural order of expressions used to canonicalize operands of commutative operations.
+         */
+        [[nodiscard]] inline int compare(const Expression& a, const Expression& b) {
+            if (&a == &b) {
+                return 0;
+            }
+            if (a.kind() != b.kind()) {
+                return rank(a.kind()) < rank(b.kind()) ? -1 : 1;
+            }
+            if (a.kind() == Kind::Number) {
+                const auto l = std::bit_cast<std::uint64_t>(static_cast<const Number&>(a).value);
+                const auto r = std::bit_cast<std::uint64_t>(static_cast<const Number&>(b).value);
+                return l == r ? 0 : l < r ? -1 : 1;
+            }
+            if (a.kind() == Kind::Variable) {
+                const auto l = static_cast<const Variable&>(a).slot;
+                const auto r = static_cast<const Variable&>(b).slot;
+                return l == r ? 0 : l < r ? -1 : 1;
+            }
+            const auto [al, ar] = children(a);
+            const auto [bl, br] = children(b);
+            if (al) {
+                if (const int c = compare(*al, *bl); c != 0) {
+                    return c;
+                }
+            }
+            if (ar) {
+                return compare(*ar, *br);
+            }
+            return 0;
+        }
+
+        class Simplifier {
+        public:
+            std::shared_ptr<Expression> operator()(const std::shared_ptr<Expression>& e) {
+                if (const auto it = done_.find(e.get()); it != done_.end()) {
+                    return it->second;
+                }
+                auto result = rewrite(e);
+                done_.emplace(e.get(), result);
+                return result;
+            }
+
+        private:
+            std::shared_ptr<Expression> rewrite(const std::shared_ptr<Expression>& e) {
+                const Kind kind = e->kind();
+                if (is_unary(kind)) {
+                    const auto& prod = static_cast<const UnaryExpression&>(*e).prod;
+                    auto p = (*this)(prod);
+                    if (p->kind() == Kind::Number) {
+                        return std::make_shared<Number>(apply(kind, static_cast<const Number&>(*p).value));
+                    }
+                    if (kind == Kind::Negative && p->kind() == Kind::Negative) {
+                        return static_cast<const UnaryExpression&>(*p).prod;
+                    }
+                    return p == prod ? e : make_unary(kind, std::move(p));
+                }
+
+                if (is_binary(kind)) {
+                    const auto& b = static_cast<const BinaryExpression&>(*e);
+                    auto l = (*this)(b.lhs);
+                    auto r = (*this)(b.rhs);
+                    if (l->kind() == Kind::Number && r->kind() == Kind::Number) {
+                        return std::make_shared<Number>(apply(kind,
+                                                              static_cast<const Number&>(*l).value,
+                                                              static_cast<const Number&>(*r).value));
+                    }
+                    if (kind == Kind::Plus || kind == Kind::Mul) {
+                        if (compare(*l, *r) > 0) {
+                            std::swap(l, r);
+                        }
+                    }
+                    switch (kind) {
+                        case Kind::Plus:
+                        case Kind::Minus:
+                            if (is_number(*r, 0.0)) return l;
+                            break;
+                        case Kind::Mul:
+                        case Kind::Div:
+                        case Kind::Pow:
+                            if (is_number(*r, 1.0)) return l;
+                            break;
+                        default:
+                            break;
+                    }
+                    return l == b.lhs && r == b.rhs ? e : make_binary(kind, std::move(l), std::move(r));
+                }
+
+                return e;
+            }
+
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>> done_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Folds subtrees independent of x into single Number and removes identities: e*1, e/1, e^1, e+0, e-0
+     * and --e. Operands of + and * are put in canonical order with constants on the right. Folded
+     * out-of-domain subtrees, e.g. 1/0 or sqrt(-1), become NaN Number, so results stay the same.
+     *
+     * Constants are not reassociated (2*x*3 is kept), as it could change rounding. The only value
+     * that can change is the sign of zero: e+0 gives +0 for e = -0, while simplified e keeps -0.
+     */
+    inline Optimized simplify(const std::shared_ptr<Expression>& expression) {
+        Optimized result;
+        result.nodes_before = count_nodes(*expression);
+        result.expression = detail::Simplifier()(expression);
+        result.nodes_after = count_nodes(*result.expression);
+        return result;
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_SIMPLIFY_HPP
@@ -0,0 +1,298 @@
+#ifndef FUNCTION_PARSER_STATIC_FUNCTION_HPP
+#define FUNCTION_PARSER_STATIC_FUNCTION_HPP
+
+#include "function_parser.hpp"
+#include "tree.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace az {
+    /**
+     * String literal usable as a template argument.
+     */
+    template<std::size_t N>
+    struct FixedString {
+        char data[N]{};
+
+        constexpr FixedString(const char (&s)[N]) {
+            for (std::size_t i = 0; i < N; ++i) {
+                data[i] = s[i];
+            }
+        }
+
+        [[nodiscard]] constexpr std::string_view view() const { return {data, N - 1}; }
+    };
+
+    namespace detail {
+        struct StaticNode {
+            Kind op = Kind::Number;
+            std::size_t lhs = 0;
+            std::size_t rhs = 0;
+            double value = 0.0;
+        };
+
+        /**
+         * Expression parsed at compile time. Every node consumes at least one character, so N nodes are
+         * always enough for a string of length N.
+         */
+        template<std::size_t N>
+        struct StaticTree {
+            std::array<StaticNode, N> nodes{};
+            std::size_t size = 0;
+            std::size_t root = 0;
+        };
+
+        template<Kind K>
+        struct NodeType;
+
+        template<> struct NodeType<Kind::Sin> { using type = Sin; };
+        template<> struct NodeType<Kind::Cos> { using type = Cos; };
+        template<> struct NodeType<Kind::Tan> { using type = Tan; };
+        template<> struct NodeType<Kind::Cot> { using type = Cot; };
+        template<> struct NodeType<Kind::Sqrt> { using type = Sqrt; };
+        template<> struct NodeType<Kind::Cbrt> { using type = Cbrt; };
+        template<> struct NodeType<Kind::Ln> { using type = Ln; };
+        template<> struct NodeType<Kind::Lg> { using type = Lg; };
+        template<> struct NodeType<Kind::Log> { using type = Log; };
+        template<> struct NodeType<Kind::Arcsin> { using type = Arcsin; };
+        template<> struct NodeType<Kind::Arccos> { using type = Arccos; };
+        template<> struct NodeType<Kind::Arctan> { using type = Arctan; };
+        template<> struct NodeType<Kind::Negative> { using type = Negative; };
+        template<> struct NodeType<Kind::Pow> { using type = Pow; };
+        template<> struct NodeType<Kind::Mul> { using type = Mul; };
+        template<> struct NodeType<Kind::Div> { using type = Div; };
+        template<> struct NodeType<Kind::Plus> { using type = Plus; };
+        template<> struct NodeType<Kind::Minus> { using type = Minus; };
+
+        /**
+         * Recursive descent parser accepting the same language as grammar::exp. Invalid input ends
+         * constant evaluation with a throw, turning it into a compilation error.
+         */
+        template<std::size_t N>
+        class StaticParser {
+        public:
+            constexpr explicit StaticParser(const std::string_view input) : s_(input) {}
+
+            constexpr StaticTree<N> operator()() {
+                skip();
+                tree_.root = sum();
+                if (pos_ != s_.size()) {
+                    throw "az::static_function: unexpected character";
+                }
+                return tree_;
+            }
+
+        private:
+            static constexpr bool is_space(const char c) {
+                return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+            }
+
+            static constexpr bool is_digit(const char c) {
+                return c >= '0' && c <= '9';
+            }
+
+            static constexpr bool is_identifier(const char c) {
+                return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+            }
+
+            constexpr void skip() {
+                while (pos_ < s_.size() && is_space(s_[pos_])) ++pos_;
+            }
+
+            constexpr bool eat(const char c) {
+                if (pos_ < s_.size() && s_[pos_] == c) {
+                    ++pos_;
+                    skip();
+                    return true;
+                }
+                return false;
+            }
+
+            constexpr void expect(const char c) {
+                if (!eat(c)) {
+                    throw "az::static_function: missing parenthesis";
+                }
+            }
+
+            constexpr bool keyword(const std::string_view name) {
+                const std::size_t end = pos_ + name.size();
+                if (s_.substr(pos_, name.size()) != name || (end < s_.size() && is_identifier(s_[end]))) {
+                    return false;
+                }
+                pos_ = end;
+                skip();
+                return true;
+            }
+
+            constexpr std::size_t add(const Kind op, const std::size_t lhs = 0, const std::size_t rhs = 0,
+                                      const double value = 0.0) {
+                tree_.nodes[tree_.size] = {op, lhs, rhs, value};
+                return tree_.size++;
+            }
+
+            constexpr std::size_t sum() {
+                std::size_t l = product();
+                for (;;) {
+                    if (eat('+')) l = add(Kind::Plus, l, product());
+                    else if (eat('-')) l = add(Kind::Minus, l, product());
+                    else return l;
+                }
+            }
+
+            constexpr std::size_t product() {
+                std::size_t l = prefix();
+                for (;;) {
+                    if (eat('*')) l = add(Kind::Mul, l, prefix());
+                    else if (eat('/')) l = add(Kind::Div, l, prefix());
+                    else return l;
+                }
+            }
+
+            constexpr std::size_t prefix() {
+                if (eat('-')) {
+                    return add(Kind::Negative, prefix());
+                }
+                return power();
+            }
+
+            constexpr std::size_t power() {
+                const std::size_t l = atom();
+                if (eat('^')) {
+                    return add(Kind::Pow, l, power());
+                }
+                return l;
+            }
+
+            constexpr std::size_t atom() {
+                constexpr std::pair<std::string_view, Kind> functions[] = {
+                    {"sin", Kind::Sin}, {"cos", Kind::Cos}, {"tan", Kind::Tan}, {"cot", Kind::Cot},
+                    {"sqrt", Kind::Sqrt}, {"cbrt", Kind::Cbrt}, {"ln", Kind::Ln}, {"lg", Kind::Lg},
+                    {"log", Kind::Log}, {"arcsin", Kind::Arcsin}, {"arccos", Kind::Arccos},
+                    {"arctan", Kind::Arctan}
+                };
+                for (const auto& [name, kind] : functions) {
+                    if (keyword(name)) {
+                        expect('(');
+                        const std::size_t argument = sum();
+                        expect(')');
+                        return add(kind, argument);
+                    }
+                }
+                if (pos_ < s_.size() && is_digit(s_[pos_])) {
+                    return number();
+                }
+                if (eat('x')) {
+                    return add(Kind::X);
+                }
+                if (eat('(')) {
+                    const std::size_t e = sum();
+                    expect(')');
+                    return e;
+                }
+                throw "az::static_function: expected operand";
+            }
+
+            // Decimal digits are collected into an integer m and divided by 10^k. Both are exact doubles
+            // when m <= 2^53 and k <= 22, so the single division rounds exactly like std::stod does.
+            constexpr std::size_t number() {
+                if (s_[pos_] == '0' && pos_ + 1 < s_.size() && is_digit(s_[pos_ + 1])) {
+                    throw "az::static_function: leading zero";
+                }
+                std::uint64_t mantissa = 0;
+                int scale = 0;
+                const auto digit = [&](const char c) {
+                    if (mantissa > ((std::uint64_t{1} << 53) - (c - '0')) / 10) {
+                        throw "az::static_function: number has too many digits to convert exactly";
+                    }
+                    mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+                };
+                while (pos_ < s_.size() && is_digit(s_[pos_])) {
+                    digit(s_[pos_++]);
+                }
+                if (pos_ < s_.size() && s_[pos_] == '.') {
+                    ++pos_;
+                    if (pos_ >= s_.size() || !is_digit(s_[pos_])) {
+                        throw "az::static_function: missing fraction digits";
+                    }
+                    std::size_t end = pos_;
+                    while (end < s_.size() && is_digit(s_[end])) ++end;
+                    std::size_t last = end;
+                    while (last > pos_ && s_[last - 1] == '0') --last;
+                    for (; pos_ < last; ++pos_, ++scale) {
+                        digit(s_[pos_]);
+                    }
+                    pos_ = end;
+                }
+                skip();
+                if (scale > 22) {
+                    throw "az::static_function: number has too many digits to convert exactly";
+                }
+                double power = 1.0;
+                for (int i = 0; i < scale; ++i) power *= 10.0;
+                return add(Kind::Number, 0, 0, static_cast<double>(mantissa) / power);
+            }
+
+            std::string_view s_;
+            std::size_t pos_ = 0;
+            StaticTree<N> tree_{};
+        };
+
+        template<FixedString S>
+        consteval auto parse_static() {
+            constexpr std::size_t n = sizeof(S.data);
+            StaticParser<n> parser(S.view());
+            return parser();
+        }
+    } // namespace az::detail
+
+    /**
+     * Function parsed from the string literal at compile time. Nodes become template instantiations calling
+     * apply() of the corresponding runtime node directly, so there is no parsing at startup, no virtual call
+     * and the compiler can inline the whole expression, with the same NaN and domain semantics as the tree.
+     * Invalid expressions fail to compile. Digits of a number, without trailing zeros of its fraction,
+     * must form an integer of at most 2^53 and there may be at most 22 of them after the period, so
+     * that the conversion is exact.
+     *
+     * az::static_function<"6/3*(x+1)"> f;
+     * f(2); // 6
+     */
+    template<FixedString S>
+    class static_function {
+    public:
+        [[nodiscard]] static double evaluate(const double x) {
+            return eval<tree.root>(x);
+        }
+
+        double operator()(const double x) const {
+            return evaluate(x);
+        }
+
+        /**
+         * Number of nodes of the parsed expression.
+         */
+        static constexpr std::size_t size() { return tree.size; }
+
+    private:
+        static constexpr auto tree = detail::parse_static<S>();
+
+        template<std::size_t I>
+        [[nodiscard]] static double eval(const double x) {
+            constexpr detail::StaticNode node = tree.nodes[I];
+            if constexpr (node.op == Kind::Number) {
+                return node.value;
+            } else if constexpr (node.op == Kind::X) {
+                return x;
+            } else if constexpr (is_binary(node.op)) {
+                return detail::NodeType<node.op>::type::apply(eval<node.lhs>(x), eval<node.rhs>(x));
+            } else {
+                return detail::NodeType<node.op>::type::apply(eval<node.lhs>(x));
+            }
+        }
+    };
+} // namespace az
+
+#endif //FUNCTION_PARSER_STATIC_FUNCTION_HPP
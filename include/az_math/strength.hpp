@@ -0,0 +1,312 @@
+#ifndef FUNCTION_PARSER_STRENGTH_HPP
+#define FUNCTION_PARSER_STRENGTH_HPP
+
+#include "function_parser.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace az {
+    enum class PolynomialScheme : std::uint8_t {
+        /// Polynomials are left as written.
+        None,
+        /// One multiplication and one addition per coefficient, in a single dependency chain.
+        Horner,
+        /// Halves evaluated independently and joined by powers x^2, x^4, ..., so they can run in parallel.
+        Estrin
+    };
+
+    struct StrengthOptions {
+        /// Largest integer exponent rewritten into multiplications.
+        std::uint32_t max_exponent = 32;
+        /// Rewrite e^0.5 into sqrt(e).
+        bool sqrt = true;
+        PolynomialScheme polynomials = PolynomialScheme::Horner;
+        /// Polynomials of higher degree are left as written.
+        std::size_t max_degree = 32;
+    };
+
+    namespace detail {
+        /**
+         * Subtree seen as polynomial in one variable. Coefficient i belongs to leaf^i, leaf is empty for
+         * constants.
+         */
+        struct Polynomial {
+            std::shared_ptr<Expression> leaf;
+            std::vector<double> coefficients;
+        };
+
+        class StrengthReducer {
+        public:
+            explicit StrengthReducer(const StrengthOptions& options) : options_(options) {}
+
+            std::shared_ptr<Expression> operator()(const std::shared_ptr<Expression>& e) {
+                if (const auto it = done_.find(e.get()); it != done_.end()) {
+                    return it->second;
+                }
+                auto result = rewrite(e);
+                done_.emplace(e.get(), result);
+                return result;
+            }
+
+        private:
+            using Powers = std::unordered_map<std::uint32_t, std::shared_ptr<Expression>>;
+
+            std::shared_ptr<Expression> rewrite(const std::shared_ptr<Expression>& e) {
+                const Kind kind = e->kind();
+                if (options_.polynomials != PolynomialScheme::None && (kind == Kind::Plus || kind == Kind::Minus
+                                                                       || kind == Kind::Mul || kind == Kind::Pow)) {
+                    if (auto p = polynomial(e); p && p->leaf && p->coefficients.size() > 2) {
+                        Powers powers;
+                        return options_.polynomials == PolynomialScheme::Horner
+                                   ? horner(*p, powers)
+                                   : estrin(*p, 0, std::bit_ceil(p->coefficients.size()), powers);
+                    }
+                }
+
+                if (is_unary(kind)) {
+                    const auto& prod = static_cast<const UnaryExpression&>(*e).prod;
+                    auto p = (*this)(prod);
+                    return p == prod ? e : make_unary(kind, std::move(p));
+                }
+
+                if (is_binary(kind)) {
+                    const auto& b = static_cast<const BinaryExpression&>(*e);
+                    auto l = (*this)(b.lhs);
+                    if (kind == Kind::Pow && b.rhs->kind() == Kind::Number) {
+                        const double n = number_value(*b.rhs);
+                        if (options_.sqrt && n == 0.5) {
+                            return std::make_shared<Sqrt>(std::move(l));
+                        }
+                        if (const auto exponent = integer_exponent(n)) {
+                            Powers powers;
+                            return power(l, *exponent, powers);
+                        }
+                    }
+                    auto r = (*this)(b.rhs);
+                    return l == b.lhs && r == b.rhs ? e : make_binary(kind, std::move(l), std::move(r));
+                }
+
+                return e;
+            }
+
+            [[nodiscard]] std::optional<std::uint32_t> integer_exponent(const double n) const {
+                if (n >= 2 && n <= options_.max_exponent && n == std::floor(n)) {
+                    return static_cast<std::uint32_t>(n);
+                }
+                return std::nullopt;
+            }
+
+            /**
+             * Square-and-multiply chain of base^n. Powers computed on the way are kept, so later calls with the
+             * same base reuse them.
+             */
+            static std::shared_ptr<Expression> power(const std::shared_ptr<Expression>& base, const std::uint32_t n,
+                                                     Powers& powers) {
+                if (n == 1) {
+                    return base;
+                }
+                if (const auto it = powers.find(n); it != powers.end()) {
+                    return it->second;
+                }
+                const auto half = power(base, n / 2, powers);
+                std::shared_ptr<Expression> result = std::make_shared<Mul>(half, half);
+                if (n % 2 == 1) {
+                    result = std::make_shared<Mul>(std::move(result), base);
+                }
+                powers.emplace(n, result);
+                return result;
+            }
+
+            std::optional<Polynomial> polynomial(const std::shared_ptr<Expression>& e) {
+                if (not_polynomial_.contains(e.get())) {
+                    return std::nullopt;
+                }
+                auto result = extract(e);
+                if (!result) {
+                    not_polynomial_.insert(e.get());
+                }
+                return result;
+            }
+
+            std::optional<Polynomial> extract(const std::shared_ptr<Expression>& e) {
+                switch (e->kind()) {
+                    case Kind::Number:
+                        return Polynomial{nullptr, {number_value(*e)}};
+                    case Kind::X:
+                    case Kind::Variable:
+                        return Polynomial{e, {0.0, 1.0}};
+                    case Kind::Negative: {
+                        auto p = polynomial(static_cast<const UnaryExpression&>(*e).prod);
+                        if (p) {
+                            for (double& c : p->coefficients) c = -c;
+                        }
+                        return p;
+                    }
+                    case Kind::Plus:
+                    case Kind::Minus:
+                    case Kind::Mul:
+                    case Kind::Pow:
+                        break;
+                    default:
+                        return std::nullopt;
+                }
+
+                const auto& b = static_cast<const BinaryExpression&>(*e);
+                auto l = polynomial(b.lhs);
+                if (!l) {
+                    return std::nullopt;
+                }
+                // Products and powers of sums are not multiplied out: near roots of a factored form like
+                // (x-1)^10 the expanded coefficients cancel catastrophically.
+                if (e->kind() == Kind::Pow) {
+                    if (b.rhs->kind() != Kind::Number || !l->leaf || !monomial(*l)) {
+                        return std::nullopt;
+                    }
+                    const auto n = integer_exponent(number_value(*b.rhs));
+                    if (!n || *n * (l->coefficients.size() - 1) > options_.max_degree) {
+                        return std::nullopt;
+                    }
+                    Polynomial result = *l;
+                    for (std::uint32_t i = 1; i < *n; ++i) {
+                        result.coefficients = multiply(result.coefficients, l->coefficients);
+                    }
+                    return result;
+                }
+
+                auto r = polynomial(b.rhs);
+                if (!r || (l->leaf && r->leaf && !same_leaf(*l->leaf, *r->leaf))
+                    || (e->kind() == Kind::Mul && (!monomial(*l) || !monomial(*r)))) {
+                    return std::nullopt;
+                }
+                Polynomial result{l->leaf ? l->leaf : r->leaf, {}};
+                if (e->kind() == Kind::Mul) {
+                    if (l->coefficients.size() + r->coefficients.size() - 2 > options_.max_degree) {
+                        return std::nullopt;
+                    }
+                    result.coefficients = multiply(l->coefficients, r->coefficients);
+                } else {
+                    const double sign = e->kind() == Kind::Plus ? 1.0 : -1.0;
+                    result.coefficients.resize(std::max(l->coefficients.size(), r->coefficients.size()));
+                    for (std::size_t i = 0; i < l->coefficients.size(); ++i) {
+                        result.coefficients[i] = l->coefficients[i];
+                    }
+                    for (std::size_t i = 0; i < r->coefficients.size(); ++i) {
+                        result.coefficients[i] += sign * r->coefficients[i];
+                    }
+                }
+                while (result.coefficients.size() > 1 && result.coefficients.back() == 0.0) {
+                    result.coefficients.pop_back();
+                }
+                return result;
+            }
+
+            /**
+             * Whether polynomial is a single term c*leaf^k.
+             */
+            static bool monomial(const Polynomial& p) {
+                return std::count_if(p.coefficients.begin(), p.coefficients.end(),
+                                     [](const double c) { return c != 0.0; }) <= 1;
+            }
+
+            static bool same_leaf(const Expression& a, const Expression& b) {
+                const auto slot = [](const Expression& e) { return e.kind() == Kind::X ? 0 : variable_slot(e); };
+                return slot(a) == slot(b);
+            }
+
+            static std::vector<double> multiply(const std::vector<double>& a, const std::vector<double>& b) {
+                std::vector<double> result(a.size() + b.size() - 1);
+                for (std::size_t i = 0; i < a.size(); ++i) {
+                    for (std::size_t j = 0; j < b.size(); ++j) {
+                        result[i + j] += a[i] * b[j];
+                    }
+                }
+                return result;
+            }
+
+            // a * b, where a == nullptr stands for 1.
+            static std::shared_ptr<Expression> times(std::shared_ptr<Expression> a, std::shared_ptr<Expression> b) {
+                if (!a || (a->kind() == Kind::Number && number_value(*a) == 1.0)) {
+                    return b;
+                }
+                return std::make_shared<Mul>(std::move(a), std::move(b));
+            }
+
+            static std::shared_ptr<Expression> horner(const Polynomial& p, Powers& powers) {
+                const auto& c = p.coefficients;
+                std::size_t k = c.size() - 1;
+                std::shared_ptr<Expression> result = std::make_shared<Number>(c[k]);
+                while (k > 0) {
+                    std::size_t j = k - 1;
+                    while (j > 0 && c[j] == 0.0) --j;
+                    result = times(std::move(result), power(p.leaf, static_cast<std::uint32_t>(k - j), powers));
+                    if (c[j] != 0.0) {
+                        result = std::make_shared<Plus>(std::move(result), std::make_shared<Number>(c[j]));
+                    }
+                    k = j;
+                }
+                return result;
+            }
+
+            // Coefficients [first, first + size) with size a power of two, nullptr if they are all zero.
+            static std::shared_ptr<Expression> estrin(const Polynomial& p, const std::size_t first, const std::size_t size,
+                                                      Powers& powers) {
+                if (first >= p.coefficients.size()) {
+                    return nullptr;
+                }
+                if (size == 1) {
+                    const double c = p.coefficients[first];
+                    return c == 0.0 ? nullptr : std::make_shared<Number>(c);
+                }
+                auto low = estrin(p, first, size / 2, powers);
+                auto high = estrin(p, first + size / 2, size / 2, powers);
+                if (!high) {
+                    return low;
+                }
+                auto term = times(std::move(high), power(p.leaf, static_cast<std::uint32_t>(size / 2), powers));
+                return low ? std::make_shared<Plus>(std::move(term), std::move(low)) : term;
+            }
+
+            StrengthOptions options_;
+            std::unordered_map<const Expression*, std::shared_ptr<Expression>> done_;
+            std::unordered_set<const Expression*> not_polynomial_;
+        };
+    } // namespace az::detail
+
+    /**
+     * Replaces expensive operations with cheaper ones:
+     *
+     * - e^n with integer 2 <= n <= max_exponent becomes a square-and-multiply chain, e.g. x^5 = (x*x)^2*x.
+     *   e^2 is exact, higher powers round after every multiplication and may differ from std::pow in the
+     *   last bits, gradual underflow included. NaN, infinities and signed zeros give the same results.
+     * - e^0.5 becomes sqrt(e). It differs from std::pow only for e = -0 (-0 instead of +0) and e = -inf
+     *   (NaN instead of +inf).
+     * - Sums of terms c*x^k of a single variable, with + and - and negation, are collected into
+     *   polynomials of degree at least 2 and evaluated with Horner's or Estrin's scheme. Coefficients of
+     *   equal powers are combined and operations reassociated, so the result can differ by rounding, and for
+     *   infinite x where term by term evaluation gives inf - inf = NaN. Products and powers of sums, like
+     *   (x-1)^10, are not multiplied out, as the expanded form loses all precision near their roots; their
+     *   integer powers become multiplication chains.
+     *
+     * Node count may grow, as every multiplication of a chain is a node.
+     */
+    inline Optimized reduce_strength(const std::shared_ptr<Expression>& expression, const StrengthOptions& options = {}) {
+        Optimized result;
+        result.nodes_before = count_nodes(*expression);
+        result.expression = detail::StrengthReducer(options)(expression);
+        result.nodes_after = count_nodes(*result.expression);
+        return result;
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_STRENGTH_HPP
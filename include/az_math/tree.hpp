@@ -0,0 +1,154 @@
+#ifndef FUNCTION_PARSER_TREE_HPP
+#define FUNCTION_PARSER_TREE_HPP
+
+#include "function_parser.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace az {
+    [[nodiscard]] constexpr bool is_binary(const Kind kind) {
+        switch (kind) {
+            case Kind::Pow:
+            case Kind::Mul:
+            case Kind::Div:
+            case Kind::Plus:
+            case Kind::Minus:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] constexpr bool is_unary(const Kind kind) {
+        return kind != Kind::Number && kind != Kind::X && kind != Kind::Variable && !is_binary(kind);
+    }
+
+    /**
+     * Returns operands of the node. Unary nodes have only the first one set, leaves none.
+     */
+    [[nodiscard]] inline std::pair<const Expression*, const Expression*> children(const Expression& e) {
+        if (is_binary(e.kind())) {
+            const auto& b = static_cast<const BinaryExpression&>(e);
+            return {b.lhs.get(), b.rhs.get()};
+        }
+        if (is_unary(e.kind())) {
+            return {static_cast<const UnaryExpression&>(e).prod.get(), nullptr};
+        }
+        return {nullptr, nullptr};
+    }
+
+    [[nodiscard]] inline double number_value(const Expression& e) {
+        return static_cast<const Number&>(e).value;
+    }
+
+    [[nodiscard]] inline std::uint32_t variable_slot(const Expression& e) {
+        return static_cast<const Variable&>(e).slot;
+    }
+
+    template<std::floating_point T>
+    [[nodiscard]] T apply(const Kind kind, const T t) {
+        switch (kind) {
+            case Kind::Sin: return Sin::apply(t);
+            case Kind::Cos: return Cos::apply(t);
+            case Kind::Tan: return Tan::apply(t);
+            case Kind::Cot: return Cot::apply(t);
+            case Kind::Sqrt: return Sqrt::apply(t);
+            case Kind::Cbrt: return Cbrt::apply(t);
+            case Kind::Ln: return Ln::apply(t);
+            case Kind::Lg: return Lg::apply(t);
+            case Kind::Log: return Log::apply(t);
+            case Kind::Arcsin: return Arcsin::apply(t);
+            case Kind::Arccos: return Arccos::apply(t);
+            case Kind::Arctan: return Arctan::apply(t);
+            case Kind::Negative: return Negative::apply(t);
+            default: return std::numeric_limits<T>::quiet_NaN();
+        }
+    }
+
+    template<std::floating_point T>
+    [[nodiscard]] T apply(const Kind kind, const T l, const T r) {
+        switch (kind) {
+            case Kind::Pow: return Pow::apply(l, r);
+            case Kind::Mul: return Mul::apply(l, r);
+            case Kind::Div: return Div::apply(l, r);
+            case Kind::Plus: return Plus::apply(l, r);
+            case Kind::Minus: return Minus::apply(l, r);
+            default: return std::numeric_limits<T>::quiet_NaN();
+        }
+    }
+
+    [[nodiscard]] inline std::shared_ptr<Expression> make_unary(const Kind kind, std::shared_ptr<Expression> p) {
+        switch (kind) {
+            case Kind::Sin: return std::make_shared<Sin>(std::move(p));
+            case Kind::Cos: return std::make_shared<Cos>(std::move(p));
+            case Kind::Tan: return std::make_shared<Tan>(std::move(p));
+            case Kind::Cot: return std::make_shared<Cot>(std::move(p));
+            case Kind::Sqrt: return std::make_shared<Sqrt>(std::move(p));
+            case Kind::Cbrt: return std::make_shared<Cbrt>(std::move(p));
+            case Kind::Ln: return std::make_shared<Ln>(std::move(p));
+            case Kind::Lg: return std::make_shared<Lg>(std::move(p));
+            case Kind::Log: return std::make_shared<Log>(std::move(p));
+            case Kind::Arcsin: return std::make_shared<Arcsin>(std::move(p));
+            case Kind::Arccos: return std::make_shared<Arccos>(std::move(p));
+            case Kind::Arctan: return std::make_shared<Arctan>(std::move(p));
+            case Kind::Negative: return std::make_shared<Negative>(std::move(p));
+            default: return nullptr;
+        }
+    }
+
+    [[nodiscard]] inline std::shared_ptr<Expression> make_binary(const Kind kind, std::shared_ptr<Expression> l,
+                                                                 std::shared_ptr<Expression> r) {
+        switch (kind) {
+            case Kind::Pow: return std::make_shared<Pow>(std::move(l), std::move(r));
+            case Kind::Mul: return std::make_shared<Mul>(std::move(l), std::move(r));
+            case Kind::Div: return std::make_shared<Div>(std::move(l), std::move(r));
+            case Kind::Plus: return std::make_shared<Plus>(std::move(l), std::move(r));
+            case Kind::Minus: return std::make_shared<Minus>(std::move(l), std::move(r));
+            default: return nullptr;
+        }
+    }
+
+    /**
+     * Result of an optimization pass: rewritten expression together with node counts before and after it.
+     */
+    struct Optimized {
+        std::shared_ptr<Expression> expression;
+        std::size_t nodes_before = 0;
+        std::size_t nodes_after = 0;
+
+        /**
+         * Number of nodes removed, 0 if the pass added nodes.
+         */
+        [[nodiscard]] std::size_t removed() const {
+            return nodes_before > nodes_after ? nodes_before - nodes_after : 0;
+        }
+    };
+
+    /**
+     * Counts distinct nodes reachable from e. Node shared by several parents is counted once.
+     */
+    [[nodiscard]] inline std::size_t count_nodes(const Expression& e) {
+        std::unordered_set<const Expression*> seen;
+        std::vector<const Expression*> stack{&e};
+        while (!stack.empty()) {
+            const Expression* node = stack.back();
+            stack.pop_back();
+            if (!seen.insert(node).second) {
+                continue;
+            }
+            const auto [l, r] = children(*node);
+            if (l) stack.push_back(l);
+            if (r) stack.push_back(r);
+        }
+        return seen.size();
+    }
+} // namespace az
+
+#endif //FUNCTION_PARSER_TREE_HPP
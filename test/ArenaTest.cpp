@@ -0,0 +1,45 @@
+#include <az_math/arena.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/tree.hpp>
+#include <gtest/gtest.h>
+
+#include <numbers>
+
+TEST(ArenaTest, MatchesTree) {
+    for (const std::string expr : {"5", "3.14*x", "6/3*(x+1)", "(2+x)*2+3*x^x", "-x-3/-x",
+                                   "sin(x)*cos(x)+tan(x)-cot(x)", "sqrt(x)+cbrt(x)+ln(x)+lg(x)+log(x)",
+                                   "arcsin(x)+arccos(x)+arctan(x)"}) {
+        const auto tree = az::parse_expression(expr);
+        const az::ArenaExpression arena = az::parse_arena(expr);
+        ASSERT_TRUE(tree) << expr;
+        ASSERT_TRUE(arena) << expr;
+        EXPECT_EQ(arena.size(), az::count_nodes(*tree)) << expr;
+        for (const double x : {-1.5, 0.0, 0.14, 3.14}) {
+            const double expected = tree->evaluate(x);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(arena.evaluate(x))) << expr << " at x = " << x;
+            } else {
+                EXPECT_EQ(arena.evaluate(x), expected) << expr << " at x = " << x;
+            }
+        }
+    }
+}
+
+TEST(ArenaTest, OutOfDomain) {
+    const az::ArenaExpression cot = az::parse_arena("cot(x)");
+    ASSERT_TRUE(cot);
+    EXPECT_TRUE(std::isnan(cot.evaluate(std::numbers::pi)));
+    const az::ArenaExpression division = az::parse_arena("1/x");
+    ASSERT_TRUE(division);
+    EXPECT_TRUE(std::isnan(division.evaluate(0)));
+}
+
+TEST(ArenaTest, Compile) {
+    const az::ArenaExpression arena = az::parse_arena("(2+x)*2+3*x^x");
+    ASSERT_TRUE(arena);
+    EXPECT_EQ(az::compile(arena).evaluate(3.14), arena.evaluate(3.14));
+}
+
+TEST(ArenaTest, InvalidFunction) {
+    EXPECT_FALSE(az::parse_arena("2x"));
+}
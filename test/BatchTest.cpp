@@ -0,0 +1,117 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <vector>
+
+namespace {
+    std::vector<double> grid(const double from, const double to, const std::size_t n) {
+        std::vector<double> xs(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            xs[i] = from + (to - from) * static_cast<double>(i) / static_cast<double>(n - 1);
+        }
+        return xs;
+    }
+
+    void expectSameAsScalar(const std::string& expr, const std::vector<double>& xs) {
+        const auto tree = az::parse_expression(expr);
+        ASSERT_TRUE(tree) << expr;
+        const az::Program program = az::compile(*tree);
+        std::vector<double> out(xs.size());
+        program.evaluate_batch(xs, out);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            const double expected = tree->evaluate(xs[i]);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(out[i])) << expr << " at x = " << xs[i];
+            } else {
+                EXPECT_EQ(out[i], expected) << expr << " at x = " << xs[i];
+            }
+        }
+    }
+}
+
+TEST(BatchTest, Arithmetic) {
+    const auto xs = grid(-3, 3, 1001);
+    expectSameAsScalar("x+2", xs);
+    expectSameAsScalar("x-2", xs);
+    expectSameAsScalar("x*x", xs);
+    expectSameAsScalar("1/x", xs);
+    expectSameAsScalar("-x", xs);
+    expectSameAsScalar("x^3-2*x^2+x/(x-1)", xs);
+}
+
+TEST(BatchTest, Functions) {
+    const auto xs = grid(-4, 4, 777);
+    expectSameAsScalar("sin(x)+cos(x)+tan(x)", xs);
+    expectSameAsScalar("cot(x)", xs);
+    expectSameAsScalar("sqrt(x)", xs);
+    expectSameAsScalar("cbrt(x)+arctan(x)", xs);
+    expectSameAsScalar("ln(x)", xs);
+    expectSameAsScalar("lg(x)*log(x)", xs);
+    expectSameAsScalar("arcsin(x)", xs);
+    expectSameAsScalar("arccos(x)", xs);
+}
+
+TEST(BatchTest, OutOfDomainLanes) {
+    const std::vector<double> xs{0.0, -0.0, 1e-11, -1.0, 1.0, std::numeric_limits<double>::quiet_NaN(),
+                                 std::numeric_limits<double>::infinity(), 2.0, 0.5};
+    expectSameAsScalar("1/x", xs);
+    expectSameAsScalar("sqrt(x)", xs);
+    expectSameAsScalar("-x+x*x-x", xs);
+    expectSameAsScalar("ln(x)", xs);
+    expectSameAsScalar("arccos(x)", xs);
+    expectSameAsScalar("1/sin(x)", xs);
+}
+
+namespace {
+    template<typename T>
+    void expectKernelsMatchScalar(const az::detail::BasicKernels<T>& kernels) {
+        constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+        const std::vector<T> l{1.0, -2.0, 0.0, 1e-11, nan, 3.5, -0.0, 7.0, 9.0, 0.5, 2.0, -3.0, 4.0, 1.0, 1.0, 6.0, 8.0};
+        const std::vector<T> r{0.0, 1e-11, -4.0, 2.0, 1.0, nan, -1e-9, 3.0, -1.0, 1e-6, 5.0, 2.0, 0.0, -8.0, nan, 3.0, 1.0};
+        std::vector<T> expected(l.size());
+        std::vector<T> actual(l.size());
+
+        const auto check = [&](const char* name) {
+            for (std::size_t i = 0; i < l.size(); ++i) {
+                if (std::isnan(expected[i])) {
+                    EXPECT_TRUE(std::isnan(actual[i])) << kernels.name << ' ' << name << " lane " << i;
+                } else {
+                    EXPECT_EQ(actual[i], expected[i]) << kernels.name << ' ' << name << " lane " << i;
+                }
+            }
+        };
+
+        az::detail::scalar::div(l.data(), r.data(), expected.data(), l.size());
+        kernels.div(l.data(), r.data(), actual.data(), l.size());
+        check("div");
+        az::detail::scalar::fast_div(l.data(), r.data(), expected.data(), l.size());
+        kernels.fast_div(l.data(), r.data(), actual.data(), l.size());
+        check("fast_div");
+        az::detail::scalar::sqrt(l.data(), expected.data(), l.size());
+        kernels.sqrt(l.data(), actual.data(), l.size());
+        check("sqrt");
+        az::detail::scalar::negative(l.data(), expected.data(), l.size());
+        kernels.negative(l.data(), actual.data(), l.size());
+        check("negative");
+        az::detail::scalar::minus(l.data(), r.data(), expected.data(), l.size());
+        kernels.minus(l.data(), r.data(), actual.data(), l.size());
+        check("minus");
+    }
+}
+
+TEST(BatchTest, KernelsMatchScalar) {
+    expectKernelsMatchScalar(az::detail::kernels());
+    expectKernelsMatchScalar(az::detail::kernels<float>());
+#ifdef AZ_MATH_X86_KERNELS
+    if (__builtin_cpu_supports("avx2")) {
+        expectKernelsMatchScalar(az::detail::avx2::kernels);
+        expectKernelsMatchScalar(az::detail::avx2::float_kernels);
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        expectKernelsMatchScalar(az::detail::avx512::kernels);
+        expectKernelsMatchScalar(az::detail::avx512::float_kernels);
+    }
+#endif
+}
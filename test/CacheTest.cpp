@@ -0,0 +1,64 @@
+#include <az_math/cache.hpp>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(CacheTest, Normalization) {
+    EXPECT_EQ(az::normalize_expression(" 6 / 3 * ( x + 1 ) "), "6/3*(x+1)");
+    EXPECT_EQ(az::normalize_expression("sin (x)\t+\n1"), "sin(x)+1");
+    EXPECT_EQ(az::normalize_expression("1  2"), "1 2");
+}
+
+TEST(CacheTest, HitsAndMisses) {
+    az::ParseCache cache;
+    const auto first = cache.get("6/3*(x+1)");
+    const auto second = cache.get(" 6 / 3 * (x + 1)");
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first, second);
+    EXPECT_DOUBLE_EQ(first->evaluate(2), 6.0);
+    EXPECT_FALSE(cache.get("1 2"));
+    EXPECT_FALSE(cache.get("2x"));
+
+    const az::CacheStatistics statistics = cache.statistics();
+    EXPECT_EQ(statistics.hits, 1);
+    EXPECT_EQ(statistics.misses, 3);
+    EXPECT_EQ(statistics.entries, 1);
+    EXPECT_GT(statistics.bytes, 0);
+}
+
+TEST(CacheTest, EvictsLeastRecentlyUsed) {
+    az::ParseCache cache(1024, 1);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(cache.get("x+" + std::to_string(i)));
+    }
+    const az::CacheStatistics statistics = cache.statistics();
+    EXPECT_LE(statistics.bytes, 1024);
+    EXPECT_GT(statistics.evictions, 0);
+    EXPECT_EQ(statistics.entries + statistics.evictions, 100);
+
+    cache.get("x+99");
+    EXPECT_EQ(cache.statistics().hits, 1);
+    cache.get("x+0");
+    EXPECT_EQ(cache.statistics().misses, 101);
+}
+
+TEST(CacheTest, ConcurrentLookups) {
+    az::ParseCache cache;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache] {
+            for (int i = 0; i < 1000; ++i) {
+                const auto program = cache.get("x*" + std::to_string(i % 50));
+                ASSERT_TRUE(program);
+                EXPECT_DOUBLE_EQ(program->evaluate(2), 2.0 * (i % 50));
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    const az::CacheStatistics statistics = cache.statistics();
+    EXPECT_EQ(statistics.hits + statistics.misses, 8000);
+    EXPECT_EQ(statistics.entries, 50);
+}
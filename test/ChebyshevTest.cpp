@@ -0,0 +1,115 @@
+#include <az_math/chebyshev.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/serialize_chebyshev.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <vector>
+
+namespace {
+    constexpr double pi = std::numbers::pi;
+
+    /**
+     * Largest difference between the function and its approximation at evenly spaced points where both
+     * are defined.
+     */
+    double max_error(const az::Expression& function, const az::Approximation& approximation) {
+        constexpr int samples = 10000;
+        double error = 0.0;
+        for (int i = 0; i <= samples; ++i) {
+            const double x = approximation.lo() + (approximation.hi() - approximation.lo()) * i / samples;
+            const double y = approximation.evaluate(x);
+            if (!std::isnan(y)) {
+                error = std::max(error, std::abs(function.evaluate(x) - y));
+            }
+        }
+        return error;
+    }
+}
+
+TEST(ChebyshevTest, ApproximatesSmoothFunctions) {
+    const auto function = az::parse_expression("arctan(ln(sqrt(x + 2))) + sin(3*x)");
+    const az::Approximation approximation = az::approximate(*function, 0.0, 5.0, 1e-10);
+    EXPECT_LE(approximation.error(), 1e-10);
+    EXPECT_LT(max_error(*function, approximation), 1e-9);
+    EXPECT_LT(approximation.size(), 16);
+    EXPECT_TRUE(std::isnan(approximation.evaluate(-0.1)));
+    EXPECT_TRUE(std::isnan(approximation.evaluate(5.1)));
+    EXPECT_NEAR(approximation.evaluate(5.0), function->evaluate(5.0), 1e-9);
+
+    // Polynomial is represented exactly, trailing coefficients are dropped.
+    const az::Approximation cubic = az::approximate(*az::parse_expression("x^3 - 2*x"), -1.0, 3.0, 1e-12);
+    EXPECT_EQ(cubic.size(), 1);
+    EXPECT_EQ(cubic.coefficients().size(), 4);
+    EXPECT_NEAR(cubic.evaluate(2.0), 4.0, 1e-12);
+}
+
+TEST(ChebyshevTest, LeavesGapsAtPolesAndDomainEdges) {
+    const auto reciprocal = az::parse_expression("1/(x-1)");
+    const az::Approximation hyperbola = az::approximate(*reciprocal, 0.0, 3.0, 1e-9);
+    EXPECT_TRUE(std::isnan(hyperbola.evaluate(1.0)));
+    EXPECT_NEAR(hyperbola.evaluate(0.5), -2.0, 1e-8);
+    EXPECT_NEAR(hyperbola.evaluate(2.0), 1.0, 1e-8);
+    EXPECT_NEAR(hyperbola.evaluate(1.001), 1000.0, 1e-3);
+
+    const auto circle = az::parse_expression("sqrt(1 - x^2)");
+    const az::Approximation half = az::approximate(*circle, -2.0, 2.0, 1e-9);
+    EXPECT_TRUE(std::isnan(half.evaluate(-1.5)));
+    EXPECT_TRUE(std::isnan(half.evaluate(1.5)));
+    EXPECT_NEAR(half.evaluate(0.0), 1.0, 1e-9);
+    EXPECT_NEAR(half.evaluate(0.6), 0.8, 1e-9);
+
+    const az::Approximation tangent = az::approximate(*az::parse_expression("tan(x)"), -3.0, 3.0, 1e-9);
+    EXPECT_TRUE(std::isnan(tangent.evaluate(pi / 2)));
+    EXPECT_NEAR(tangent.evaluate(1.0), std::tan(1.0), 1e-8);
+    EXPECT_NEAR(tangent.evaluate(-2.0), std::tan(-2.0), 1e-8);
+
+    const az::Approximation undefined = az::approximate(*az::parse_expression("ln(x)"), -2.0, -1.0, 1e-9);
+    EXPECT_EQ(undefined.size(), 1);
+    EXPECT_TRUE(undefined.coefficients().empty());
+    EXPECT_TRUE(std::isnan(undefined.evaluate(-1.5)));
+}
+
+TEST(ChebyshevTest, ReportsAchievedError) {
+    const auto function = az::parse_expression("sin(40*x)");
+    const az::Approximation coarse = az::approximate(*function, 0.0, 10.0, 1e-12, {.max_degree = 8, .max_pieces = 4});
+    EXPECT_LE(coarse.size(), 4);
+    EXPECT_GT(coarse.error(), 1e-12);
+    EXPECT_LE(max_error(*function, coarse), 2 * coarse.error());
+
+    std::vector<double> xs{0.5, 1.5, 7.25};
+    std::vector<double> ys(xs.size());
+    const az::Approximation fine = az::approximate(*function, 0.0, 10.0, 1e-8);
+    fine.evaluate_batch(xs, ys);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        EXPECT_NEAR(ys[i], std::sin(40 * xs[i]), 1e-7);
+    }
+}
+
+TEST(ChebyshevTest, SerializesPieceTable) {
+    const az::Approximation approximation = az::approximate(*az::parse_expression("sqrt(x) * cos(x)"), -1.0, 4.0, 1e-9);
+    const std::vector<std::byte> bytes = az::save_approximation(approximation);
+    const auto loaded = az::load_approximation(bytes);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(loaded->size(), approximation.size());
+    EXPECT_EQ(loaded->error(), approximation.error());
+    for (const double x : {-0.5, 0.0, 0.3, 2.0, 4.0}) {
+        const double expected = approximation.evaluate(x);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(loaded->evaluate(x)));
+        } else {
+            EXPECT_EQ(loaded->evaluate(x), expected);
+        }
+    }
+
+    EXPECT_FALSE(az::load_approximation(std::span(bytes).first(bytes.size() - 1)));
+    std::vector<std::byte> corrupted = bytes;
+    corrupted[24] = std::byte{0x7f};
+    corrupted[31] = std::byte{0x7f};
+    EXPECT_FALSE(az::load_approximation(corrupted));
+    corrupted = bytes;
+    corrupted.back() = std::byte{0xff};
+    EXPECT_FALSE(az::load_approximation(corrupted));
+    EXPECT_FALSE(az::load_approximation(az::save_program(*az::parse_expression("x"))));
+}
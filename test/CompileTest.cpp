@@ -0,0 +1,73 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+
+#include <numbers>
+#include <vector>
+
+namespace {
+    void expectSameResults(const std::string& expr, std::initializer_list<double> xs) {
+        const auto tree = az::parse_expression(expr);
+        ASSERT_TRUE(tree) << expr;
+        const az::Program program = az::compile(*tree);
+        for (const double x : xs) {
+            const double expected = tree->evaluate(x);
+            const double actual = program.evaluate(x);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(actual)) << expr << " at x = " << x;
+            } else {
+                EXPECT_EQ(actual, expected) << expr << " at x = " << x;
+            }
+        }
+    }
+}
+
+TEST(CompileTest, MatchesTree) {
+    const auto xs = {-2.5, -1.0, 0.0, 0.14, 1.0, 3.14};
+    expectSameResults("5", xs);
+    expectSameResults("x", xs);
+    expectSameResults("6/3*(x+1)", xs);
+    expectSameResults("(2+x)*2+3*x^x", xs);
+    expectSameResults("x^5^5", xs);
+    expectSameResults("-x-3/-x", xs);
+    expectSameResults("sin(x)*cos(x)+tan(x)-cot(x)", xs);
+    expectSameResults("sqrt(x)+cbrt(x)+ln(x)+lg(x)+log(x)", xs);
+    expectSameResults("arcsin(x)+arccos(x)+arctan(x)", xs);
+}
+
+TEST(CompileTest, OutOfDomain) {
+    expectSameResults("cot(x)", {0.0, std::numbers::pi});
+    expectSameResults("sqrt(x)", {-1.0, -std::numbers::pi});
+    expectSameResults("1/x", {0.0});
+    expectSameResults("1/sin(x)", {std::numbers::pi});
+    expectSameResults("ln(x)*0", {0.0, -1.0});
+}
+
+TEST(CompileTest, RegistersAreReused) {
+    const auto tree = az::parse_expression("x+x+x+x+x+x+x+x");
+    ASSERT_TRUE(tree);
+    const az::Program program = az::compile(*tree);
+    EXPECT_EQ(program.instructions().size(), 15);
+    EXPECT_EQ(program.registers(), 2);
+}
+
+TEST(CompileTest, SharedNodesAreComputedOnce) {
+    const std::shared_ptr<az::Expression> sin = std::make_shared<az::Sin>(std::make_shared<az::X>());
+    const auto tree = std::make_shared<az::Mul>(sin, sin);
+    const az::Program program = az::compile(*tree);
+    EXPECT_EQ(program.instructions().size(), 3);
+    EXPECT_DOUBLE_EQ(program.evaluate(0.5), std::sin(0.5) * std::sin(0.5));
+}
+
+TEST(CompileTest, EmptyProgramIsNaN) {
+    const az::Program program;
+    EXPECT_TRUE(program.empty());
+    EXPECT_TRUE(std::isnan(program.evaluate(1.0)));
+    std::vector<double> xs(300, 1.0);
+    std::vector<double> out(xs.size(), 0.0);
+    program.evaluate_batch(xs, out);
+    for (const double y : out) {
+        EXPECT_TRUE(std::isnan(y));
+    }
+    EXPECT_TRUE(std::isnan(az::BasicProgram<float>(program).evaluate(1.0f)));
+}
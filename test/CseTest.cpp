@@ -0,0 +1,40 @@
+#include <az_math/cse.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <az_math/simplify.hpp>
+#include <gtest/gtest.h>
+
+TEST(CseTest, MergesRepeatedSubtrees) {
+    const auto result = az::eliminate_common_subexpressions(az::parse_expression("(x+1)*(x+1)/(x+1)"));
+    ASSERT_TRUE(result.expression);
+    EXPECT_EQ(result.nodes_before, 11);
+    EXPECT_EQ(result.nodes_after, 5);
+    EXPECT_EQ(result.removed(), 6);
+    EXPECT_DOUBLE_EQ(result.expression->evaluate(2), 3.0);
+
+    const az::Program program = az::compile(*result.expression);
+    EXPECT_EQ(program.instructions().size(), 5);
+    EXPECT_DOUBLE_EQ(program.evaluate(2), 3.0);
+}
+
+TEST(CseTest, TrigonometricIdentity) {
+    const auto tree = az::parse_expression("sin(x)^2 + 2*sin(x)*cos(x) + cos(x)^2");
+    const auto result = az::eliminate_common_subexpressions(tree);
+    EXPECT_EQ(result.nodes_before, 17);
+    EXPECT_EQ(result.nodes_after, 10);
+    const az::Program program = az::compile(*result.expression);
+    for (const double x : {-1.0, 0.0, 0.5, 2.0}) {
+        EXPECT_EQ(program.evaluate(x), tree->evaluate(x));
+    }
+}
+
+TEST(CseTest, DifferentConstantsStayApart) {
+    const auto result = az::eliminate_common_subexpressions(az::parse_expression("(x+1)*(x+2)"));
+    EXPECT_EQ(result.nodes_after, result.nodes_before - 1);
+}
+
+TEST(CseTest, AfterSimplify) {
+    const auto simplified = az::simplify(az::parse_expression("2*sin(x)+sin(x)*2"));
+    const auto result = az::eliminate_common_subexpressions(simplified.expression);
+    EXPECT_EQ(result.nodes_after, 5);
+}
@@ -0,0 +1,93 @@
+#include <az_math/derivative.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <numbers>
+#include <string>
+
+namespace {
+    void expect_derivative(const std::string& f, double (*expected)(double), std::initializer_list<double> xs) {
+        const auto tree = az::parse_expression(f);
+        ASSERT_TRUE(tree) << f;
+        const auto derivative = az::differentiate(*tree);
+        const az::Program program = az::compile(*tree);
+        for (const double x : xs) {
+            EXPECT_NEAR(derivative->evaluate(x), expected(x), 1e-9) << f << " at " << x;
+            const az::Dual dual = az::evaluate_with_derivative(program, x);
+            EXPECT_EQ(dual.value, program.evaluate(x)) << f << " at " << x;
+            EXPECT_NEAR(dual.derivative, expected(x), 1e-9) << f << " at " << x;
+        }
+    }
+}
+
+TEST(DerivativeTest, Polynomials) {
+    expect_derivative("3*x^2 - 2*x + 7", [](double x) { return 6 * x - 2; }, {-2.0, 0.0, 1.5});
+    expect_derivative("-x^3", [](double x) { return -3 * x * x; }, {-1.0, 2.0});
+    expect_derivative("(x+1)/(x-1)", [](double x) { return -2 / ((x - 1) * (x - 1)); }, {-3.0, 0.0, 2.0});
+}
+
+TEST(DerivativeTest, Trigonometric) {
+    expect_derivative("sin(x)", [](double x) { return std::cos(x); }, {0.0, 1.0, 3.0});
+    expect_derivative("cos(2*x)", [](double x) { return -2 * std::sin(2 * x); }, {0.0, 1.0});
+    expect_derivative("tan(x)", [](double x) { return 1 / (std::cos(x) * std::cos(x)); }, {0.0, 1.0});
+    expect_derivative("cot(x)", [](double x) { return -1 / (std::sin(x) * std::sin(x)); }, {0.5, 2.0});
+    expect_derivative("arcsin(x)", [](double x) { return 1 / std::sqrt(1 - x * x); }, {0.0, 0.5});
+    expect_derivative("arccos(x)", [](double x) { return -1 / std::sqrt(1 - x * x); }, {-0.5, 0.5});
+    expect_derivative("arctan(x^2)", [](double x) { return 2 * x / (1 + x * x * x * x); }, {-1.0, 2.0});
+}
+
+TEST(DerivativeTest, RootsAndLogarithms) {
+    expect_derivative("sqrt(x)", [](double x) { return 0.5 / std::sqrt(x); }, {1.0, 4.0});
+    expect_derivative("cbrt(x)", [](double x) { return 1 / (3 * std::cbrt(x) * std::cbrt(x)); }, {-8.0, 1.0});
+    expect_derivative("ln(x^2+1)", [](double x) { return 2 * x / (x * x + 1); }, {-1.0, 3.0});
+    expect_derivative("lg(x)", [](double x) { return 1 / (x * std::log(2.0)); }, {1.0, 8.0});
+    expect_derivative("log(x)", [](double x) { return 1 / (x * std::log(10.0)); }, {1.0, 10.0});
+}
+
+TEST(DerivativeTest, VariableExponent) {
+    expect_derivative("x^x", [](double x) { return std::pow(x, x) * (std::log(x) + 1); }, {0.5, 2.0});
+    expect_derivative("2^x", [](double x) { return std::pow(2, x) * std::log(2.0); }, {-1.0, 3.0});
+}
+
+TEST(DerivativeTest, ConstantFactorsDoNotGrowTree) {
+    const auto derivative = az::differentiate(*az::parse_expression("5*x"));
+    EXPECT_EQ(az::count_nodes(*derivative), 1);
+    EXPECT_EQ(derivative->evaluate(123), 5.0);
+    EXPECT_EQ(az::count_nodes(*az::differentiate(*az::parse_expression("sin(2)+7"))), 1);
+}
+
+TEST(DerivativeTest, DualIsNaNOutOfDomain) {
+    const az::Program program = az::compile(*az::parse_expression("ln(x)"));
+    const az::Dual dual = az::evaluate_with_derivative(program, -1);
+    EXPECT_TRUE(std::isnan(dual.value));
+    EXPECT_TRUE(std::isnan(dual.derivative));
+}
+
+TEST(DerivativeTest, DomainMatchesDual) {
+    const auto expect_same = [](const std::string& f, const double x) {
+        const auto tree = az::parse_expression(f);
+        ASSERT_TRUE(tree) << f;
+        const double symbolic = az::differentiate(*tree)->evaluate(x);
+        const az::Dual dual = az::evaluate_with_derivative(az::compile(*tree), x);
+        if (std::isnan(dual.derivative)) {
+            EXPECT_TRUE(std::isnan(symbolic)) << f << " at " << x;
+        } else {
+            EXPECT_NEAR(symbolic, dual.derivative, 1e-9 * std::abs(dual.derivative)) << f << " at " << x;
+        }
+    };
+    // Denominators are not squared, so derivatives are defined as close to a pole as the function.
+    expect_same("1/x", 1e-6);
+    expect_same("(x+1)/x", -1e-7);
+    expect_same("tan(x)", std::numbers::pi / 2 - 1e-6);
+    expect_same("cot(x)", 1e-6);
+    expect_same("sqrt(x)", 1e-24);
+    expect_same("ln(x)", 1e-12);
+    EXPECT_NEAR(az::differentiate(*az::parse_expression("1/x"))->evaluate(1e-6), -1e12, 1e-3);
+    // Logarithms stay undefined where the function is.
+    expect_same("ln(x)", -1.0);
+    expect_same("lg(x)", -1.0);
+    expect_same("log(x - 2)", 1.0);
+    expect_same("ln(x)", 0.0);
+    EXPECT_TRUE(std::isnan(az::differentiate(*az::parse_expression("ln(x)"))->evaluate(-1.0)));
+}
@@ -0,0 +1,107 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/fused.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<std::shared_ptr<az::Expression>> parse_all(const std::vector<std::string>& expressions) {
+        std::vector<std::shared_ptr<az::Expression>> result;
+        for (const std::string& expression : expressions) {
+            result.push_back(az::parse_expression(expression));
+        }
+        return result;
+    }
+
+    /**
+     * Evaluates fused program over xs into one column per expression.
+     */
+    std::vector<std::vector<double>> columns_of(const az::FusedProgram& program, const std::vector<double>& xs) {
+        std::vector<std::vector<double>> columns(program.size(), std::vector<double>(xs.size()));
+        std::vector<std::span<double>> spans(columns.begin(), columns.end());
+        program.evaluate_batch(xs, spans);
+        return columns;
+    }
+
+    void expectSame(const double expected, const double actual) {
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(actual));
+        } else {
+            EXPECT_EQ(expected, actual);
+        }
+    }
+}
+
+TEST(FusedTest, MatchesSeparatePrograms) {
+    const auto expressions = parse_all({
+        "sin(x) + x^2", "sin(x)*2", "x^2 - sin(x)", "ln(x)", "1/(x - 1)", "3", "x", "sqrt(x^2 - 4) * cos(x)"
+    });
+    const az::FusedProgram fused = az::compile_fused(expressions);
+    ASSERT_EQ(fused.size(), expressions.size());
+
+    // More than one block and a partial one.
+    std::vector<double> xs(700);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = -5.0 + 10.0 * static_cast<double>(i) / static_cast<double>(xs.size());
+    }
+    const auto columns = columns_of(fused, xs);
+    std::vector<double> row(fused.size());
+    for (std::size_t e = 0; e < expressions.size(); ++e) {
+        const az::Program program = az::compile(*expressions[e]);
+        std::vector<double> expected(xs.size());
+        program.evaluate_batch(xs, expected);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            expectSame(expected[i], columns[e][i]);
+        }
+    }
+    for (const double x : {-2.5, 0.0, 1.0, 4.0}) {
+        fused.evaluate(x, row);
+        for (std::size_t e = 0; e < expressions.size(); ++e) {
+            expectSame(expressions[e]->evaluate(x), row[e]);
+        }
+    }
+}
+
+TEST(FusedTest, SharesCommonSubtrees) {
+    const az::FusedProgram fused = az::compile_fused(parse_all({"sin(x) + x^2", "sin(x)*2", "x^2 - sin(x)"}));
+    EXPECT_EQ(fused.nodes_before(), 16);
+    // x, sin(x), 2, x^2 and the three results.
+    EXPECT_EQ(fused.instructions().size(), 7);
+    EXPECT_EQ(std::count_if(fused.instructions().begin(), fused.instructions().end(),
+                            [](const az::Instruction& i) { return i.op == az::Kind::Sin; }), 1);
+
+    // Repeated expressions and ones nested in others share their result.
+    const az::FusedProgram nested = az::compile_fused(parse_all({"x^2", "x^2 + 1", "x^2", "(x^2 + 1)/2"}));
+    EXPECT_EQ(nested.instructions().size(), 6);
+    std::vector<double> row(nested.size());
+    nested.evaluate(3.0, row);
+    EXPECT_EQ(row, (std::vector<double>{9.0, 10.0, 9.0, 5.0}));
+    const auto columns = columns_of(nested, {1.0, 2.0});
+    EXPECT_EQ(columns[3], (std::vector<double>{1.0, 2.5}));
+}
+
+TEST(FusedTest, ReusesRegistersOfStoredResults) {
+    std::vector<std::string> sources;
+    for (int i = 0; i < 200; ++i) {
+        sources.push_back("sin(x)*" + std::to_string(i) + " + x^2/" + std::to_string(i + 1));
+    }
+    const auto expressions = parse_all(sources);
+    const az::FusedProgram fused = az::compile_fused(expressions);
+    // Registers of sin(x) and x^2 live until the end, the rest are reused by every expression.
+    EXPECT_LT(fused.registers(), 8);
+    EXPECT_LT(fused.instructions().size(), fused.nodes_before() / 2);
+
+    const std::vector<double> xs{0.5, 1.5, 2.5};
+    const auto columns = columns_of(fused, xs);
+    for (std::size_t e = 0; e < expressions.size(); e += 37) {
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            EXPECT_EQ(columns[e][i], expressions[e]->evaluate(xs[i]));
+        }
+    }
+
+    EXPECT_EQ(az::compile_fused({}).size(), 0);
+}
@@ -0,0 +1,121 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/incremental.hpp>
+#include <az_math/tree.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <string>
+
+namespace {
+    bool same(const az::Expression& a, const az::Expression& b) {
+        if (a.kind() != b.kind()) {
+            return false;
+        }
+        if (a.kind() == az::Kind::Number) {
+            return az::number_value(a) == az::number_value(b);
+        }
+        if (a.kind() == az::Kind::Variable) {
+            return az::variable_slot(a) == az::variable_slot(b);
+        }
+        const auto [al, ar] = az::children(a);
+        const auto [bl, br] = az::children(b);
+        return (!al || same(*al, *bl)) && (!ar || same(*ar, *br));
+    }
+
+    bool changed(const az::IncrementalParser& parser, const az::Expression* node) {
+        return std::ranges::find(parser.changed(), node) != parser.changed().end();
+    }
+}
+
+TEST(IncrementalTest, EditsMatchFreshParse) {
+    az::IncrementalParser parser("sin(x+1)*(x^2-3)+ln(2*x)");
+    ASSERT_TRUE(parser.expression());
+    const std::array<az::TextEdit, 7> edits{{
+        {14, 1, "4"},        // sin(x+1)*(x^2-4)+ln(2*x)
+        {5, 0, "*cos(x)"},   // sin(x*cos(x)+1)*(x^2-4)+ln(2*x)
+        {0, 0, "("},         // (sin(x*cos(x)+1)*(x^2-4)+ln(2*x)
+        {32, 0, ")/x"},      // (sin(x*cos(x)+1)*(x^2-4)+ln(2*x))/x
+        {16, 1, "-"},        // (sin(x*cos(x)+1)-(x^2-4)+ln(2*x))/x
+        {24, 8, "2"},        // (sin(x*cos(x)+1)-(x^2-4)2)/x
+        {24, 1, ""},         // (sin(x*cos(x)+1)-(x^2-4))/x
+    }};
+    const std::array<bool, 7> valid{true, true, false, true, true, false, true};
+    for (std::size_t i = 0; i < edits.size(); ++i) {
+        EXPECT_EQ(parser.edit(edits[i]), valid[i]) << parser.text();
+        const auto fresh = az::parse_expression(parser.text());
+        ASSERT_EQ(parser.expression() != nullptr, fresh != nullptr) << parser.text();
+        if (fresh) {
+            EXPECT_TRUE(same(*parser.expression(), *fresh)) << parser.text();
+        }
+    }
+    EXPECT_EQ(parser.text(), "(sin(x*cos(x)+1)-(x^2-4))/x");
+    EXPECT_EQ(parser.expression()->evaluate(2.0), (std::sin(2.0 * std::cos(2.0) + 1.0) - 0.0) / 2.0);
+}
+
+TEST(IncrementalTest, UntouchedSubtreesAreShared) {
+    az::IncrementalParser parser("sin(x+1)*(x^2-3)+ln(2*x)");
+    const auto before = parser.expression();
+    const auto [product, logarithm] = az::children(*before);
+    const auto [sine, difference] = az::children(*product);
+
+    ASSERT_TRUE(parser.edit({14, 1, "4"}));
+    const auto after = parser.expression();
+    const auto [new_product, new_logarithm] = az::children(*after);
+    const auto [new_sine, new_difference] = az::children(*new_product);
+    EXPECT_EQ(new_logarithm, logarithm);
+    EXPECT_EQ(new_sine, sine);
+    EXPECT_NE(new_difference, difference);
+    EXPECT_EQ(az::children(*new_difference).first, az::children(*difference).first); // x^2
+    EXPECT_EQ(after->evaluate(3.0), std::sin(4.0) * 5.0 + std::log(6.0));
+
+    // Only the path from the edited number to the root is new.
+    EXPECT_EQ(parser.changed().size(), 4);
+    EXPECT_TRUE(changed(parser, after.get()));
+    EXPECT_TRUE(changed(parser, new_product));
+    EXPECT_TRUE(changed(parser, new_difference));
+    EXPECT_FALSE(changed(parser, new_sine));
+    EXPECT_FALSE(changed(parser, new_logarithm));
+    // Grammar saw (x^2-4) only.
+    EXPECT_EQ(parser.reparsed(), 7);
+}
+
+TEST(IncrementalTest, CopiedGroupsKeepTheirSubtrees) {
+    az::IncrementalParser parser("(x+1)*sqrt(x-2)");
+    const auto [sum, root] = az::children(*parser.expression());
+    // Swapping the operands reproduces both groups verbatim.
+    ASSERT_TRUE(parser.edit({0, 15, "sqrt(x-2)/(x+1)"}));
+    const auto [new_root, new_sum] = az::children(*parser.expression());
+    EXPECT_EQ(new_sum, sum);
+    EXPECT_EQ(new_root, root);
+    EXPECT_EQ(parser.changed().size(), 1);
+}
+
+TEST(IncrementalTest, InvalidTextRecovers) {
+    az::IncrementalParser parser("sin(x)+cos(x)");
+    const auto [sine, cosine] = az::children(*parser.expression());
+
+    EXPECT_FALSE(parser.edit({12, 1, ""}));
+    EXPECT_FALSE(parser.expression());
+    EXPECT_TRUE(parser.changed().empty());
+    EXPECT_EQ(parser.error().offset, 12);
+    EXPECT_FALSE(parser.error().production.empty());
+
+    ASSERT_TRUE(parser.edit({12, 0, "*2)"}));
+    const auto [new_sine, product] = az::children(*parser.expression());
+    EXPECT_EQ(new_sine, sine);
+    EXPECT_EQ(parser.expression()->evaluate(1.0), std::sin(1.0) + std::cos(2.0));
+    EXPECT_FALSE(az::IncrementalParser(")x(").expression());
+    EXPECT_FALSE(az::IncrementalParser("x+(__az_group_0)").expression());
+}
+
+TEST(IncrementalTest, Variables) {
+    az::IncrementalParser parser("a*(b+1)-sin(a)", az::Variables{"a", "b"});
+    ASSERT_TRUE(parser.expression());
+    const auto sine = az::children(*parser.expression()).second;
+    EXPECT_FALSE(parser.edit({5, 1, "c"}));
+    EXPECT_FALSE(parser.expression());
+    ASSERT_TRUE(parser.edit({5, 1, "a"}));
+    EXPECT_EQ(az::children(*parser.expression()).second, sine);
+    const std::array values{2.0, 5.0};
+    EXPECT_EQ(parser.expression()->evaluate(values), 2.0 * 7.0 - std::sin(2.0));
+}
@@ -0,0 +1,133 @@
+#include <az_math/function_parser.hpp>
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <utility>
+
+namespace {
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    constexpr double pi = std::numbers::pi;
+
+    az::Interval bound(const std::string& expression, const double lo, const double hi) {
+        return az::parse_expression(expression)->evaluate_interval({lo, hi});
+    }
+
+    /**
+     * Checks that sampled values are enclosed and that NaN appears only where domain allows it.
+     */
+    void expectEncloses(const std::string& expression, const double lo, const double hi) {
+        const auto function = az::parse_expression(expression);
+        ASSERT_TRUE(function) << expression;
+        const az::Interval result = function->evaluate_interval({lo, hi});
+        constexpr int samples = 4000;
+        bool any_nan = false;
+        bool any_value = false;
+        for (int i = 0; i <= samples; ++i) {
+            const double x = i == samples ? hi : lo + (hi - lo) * i / samples;
+            const double y = function->evaluate(x);
+            if (std::isnan(y)) {
+                any_nan = true;
+            } else {
+                any_value = true;
+                EXPECT_TRUE(result.contains(y)) << expression << " at " << x << ": " << y << " not in ["
+                                                << result.lo << ", " << result.hi << "]";
+            }
+        }
+        if (any_nan) {
+            EXPECT_NE(result.domain, az::Domain::Inside) << expression << " on [" << lo << ", " << hi << "]";
+        }
+        if (any_value) {
+            EXPECT_NE(result.domain, az::Domain::Outside) << expression << " on [" << lo << ", " << hi << "]";
+        }
+    }
+}
+
+TEST(IntervalTest, EnclosesSampledValues) {
+    const std::array expressions{
+        "sin(x)", "cos(x)", "tan(x)", "cot(x)", "sqrt(x)", "cbrt(x)", "ln(x)", "lg(x)", "log(x)",
+        "arcsin(x)", "arccos(x)", "arctan(x)", "-x", "x^2", "x^3", "x^(-1)", "x^(-2)", "x^0.5", "2^x", "x^x",
+        "x*x - 3*x", "1/x", "1/(x-1)", "(x+1)/(x-2)", "sin(x)*cos(2*x) + ln(x+3)", "sqrt(1 - x^2)",
+        "arcsin(x/2)", "tan(x)/x", "cot(x^2)"
+    };
+    const std::array<std::pair<double, double>, 7> ranges{{
+        {-3.0, 3.0}, {0.1, 0.9}, {-0.5, -0.25}, {1.0, 2.0}, {-10.0, 10.0}, {2.0, 2.0}, {0.0, pi}
+    }};
+    for (const char* expression : expressions) {
+        for (const auto& [lo, hi] : ranges) {
+            expectEncloses(expression, lo, hi);
+        }
+    }
+}
+
+TEST(IntervalTest, MonotonicPiecesOfTrigonometricFunctions) {
+    // Maximum of sine inside the range, minimum at the ends.
+    const az::Interval sine = bound("sin(x)", 0.0, pi);
+    EXPECT_EQ(sine.hi, 1.0);
+    EXPECT_LE(sine.lo, 0.0);
+    EXPECT_GT(sine.lo, -1e-15);
+    EXPECT_EQ(sine.domain, az::Domain::Inside);
+
+    // No extremum: bounds stay close to the values at the ends.
+    const az::Interval cosine = bound("cos(x)", 0.5, 1.0);
+    EXPECT_NEAR(cosine.lo, std::cos(1.0), 1e-15);
+    EXPECT_NEAR(cosine.hi, std::cos(0.5), 1e-15);
+
+    EXPECT_EQ(bound("sin(x)", -100.0, 100.0).lo, -1.0);
+
+    const az::Interval tangent = bound("tan(x)", -1.0, 1.0);
+    EXPECT_NEAR(tangent.hi, std::tan(1.0), 1e-15);
+    EXPECT_EQ(bound("tan(x)", 1.0, 2.0).hi, infinity);
+}
+
+TEST(IntervalTest, PolesAreUnbounded) {
+    const az::Interval reciprocal = bound("1/x", -1.0, 1.0);
+    EXPECT_EQ(reciprocal.domain, az::Domain::Partial);
+    EXPECT_LE(reciprocal.lo, -1e10);
+    EXPECT_GE(reciprocal.hi, 1e10);
+
+    const az::Interval away = bound("1/x", 2.0, 4.0);
+    EXPECT_EQ(away.domain, az::Domain::Inside);
+    EXPECT_NEAR(away.lo, 0.25, 1e-15);
+    EXPECT_NEAR(away.hi, 0.5, 1e-15);
+
+    EXPECT_EQ(bound("cot(x)", 3.0, 3.5).domain, az::Domain::Partial);
+    EXPECT_EQ(bound("cot(x)", 0.5, 3.0).domain, az::Domain::Inside);
+    EXPECT_EQ(bound("1/(0*x)", -1.0, 1.0).domain, az::Domain::Outside);
+}
+
+TEST(IntervalTest, DomainLimits) {
+    EXPECT_EQ(bound("sqrt(x)", -2.0, -1.0).domain, az::Domain::Outside);
+    const az::Interval root = bound("sqrt(x)", -1.0, 4.0);
+    EXPECT_EQ(root.domain, az::Domain::Partial);
+    EXPECT_LE(root.lo, 0.0);
+    EXPECT_GT(root.lo, -1e-300);
+    EXPECT_NEAR(root.hi, 2.0, 1e-15);
+
+    EXPECT_EQ(bound("ln(x)", -1.0, 0.0).domain, az::Domain::Outside);
+    const az::Interval logarithm = bound("ln(x)", 0.0, 1.0);
+    EXPECT_EQ(logarithm.domain, az::Domain::Partial);
+    EXPECT_EQ(logarithm.lo, -infinity);
+
+    EXPECT_EQ(bound("arcsin(x)", 2.0, 3.0).domain, az::Domain::Outside);
+    EXPECT_EQ(bound("arccos(x)", 0.5, 3.0).domain, az::Domain::Partial);
+    EXPECT_EQ(bound("arccos(x)", -1.0, 1.0).domain, az::Domain::Inside);
+
+    // Undefined parts propagate through the rest of the expression.
+    EXPECT_EQ(bound("sqrt(x) + 1", -3.0, -2.0).domain, az::Domain::Outside);
+    EXPECT_EQ(bound("2 * ln(x)", -3.0, 2.0).domain, az::Domain::Partial);
+    EXPECT_TRUE(std::isnan(bound("sqrt(x)", -2.0, -1.0).lo));
+}
+
+TEST(IntervalTest, Variables) {
+    const auto expression = az::parse_expression("a*b - sqrt(b)", az::Variables{"a", "b"});
+    const std::array<az::Interval, 2> ranges{{{1.0, 2.0}, {4.0, 9.0}}};
+    const az::Interval result = expression->evaluate_interval(ranges);
+    EXPECT_EQ(result.domain, az::Domain::Inside);
+    EXPECT_LE(result.lo, 1.0);
+    EXPECT_GE(result.hi, 16.0);
+    EXPECT_NEAR(result.lo, 1.0, 1e-14);
+    EXPECT_NEAR(result.hi, 16.0, 1e-14);
+}
@@ -0,0 +1,61 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/jit.hpp>
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <numbers>
+#include <vector>
+
+namespace {
+    void expectSameResults(const std::string& expr) {
+        const auto tree = az::parse_expression(expr);
+        ASSERT_TRUE(tree) << expr;
+        const az::JitFunction function(az::compile(*tree));
+        std::vector<double> xs{-2.5, -1.0, -0.0, 0.0, 1e-11, 0.14, 1.0, std::numbers::pi, 3.14, 100.0,
+                               std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()};
+        std::vector<double> out(xs.size());
+        function.evaluate_batch(xs, out);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            const double expected = tree->evaluate(xs[i]);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(function.evaluate(xs[i]))) << expr << " at x = " << xs[i];
+                EXPECT_TRUE(std::isnan(out[i])) << expr << " at x = " << xs[i];
+            } else {
+                EXPECT_EQ(function.evaluate(xs[i]), expected) << expr << " at x = " << xs[i];
+                EXPECT_EQ(out[i], expected) << expr << " at x = " << xs[i];
+            }
+        }
+    }
+}
+
+TEST(JitTest, MatchesTree) {
+    expectSameResults("5");
+    expectSameResults("x");
+    expectSameResults("6/3*(x+1)");
+    expectSameResults("(2+x)*2+3*x^x");
+    expectSameResults("-x-3/-x");
+    expectSameResults("1/x+1/sin(x)");
+    expectSameResults("sin(x)*cos(x)+tan(x)-cot(x)");
+    expectSameResults("sqrt(x)+cbrt(x)+ln(x)+lg(x)+log(x)");
+    expectSameResults("arcsin(x)+arccos(x)+arctan(x)");
+}
+
+TEST(JitTest, ManyRegisters) {
+    std::string expr = "x";
+    for (int i = 0; i < 100; ++i) {
+        expr = "(" + expr + ")*(x+" + std::to_string(i) + ")/(" + std::to_string(i + 2) + ")";
+    }
+    expectSameResults("sqrt(" + expr + ")");
+}
+
+TEST(JitTest, NativeFunctionPointer) {
+    const az::JitFunction function(az::compile(*az::parse_expression("x*x+1")));
+#ifdef AZ_MATH_JIT
+    ASSERT_TRUE(function.native());
+    const az::NativeFunction f = function.function();
+    EXPECT_EQ(f(3.0), 10.0);
+#else
+    EXPECT_FALSE(function.function());
+    EXPECT_EQ(function.evaluate(3.0), 10.0);
+#endif
+}
@@ -0,0 +1,83 @@
+#include <az_math/loader.hpp>
+#include <az_math/serialize.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST(LoaderTest, ProgramsInInputOrder) {
+    std::string text;
+    for (int i = 0; i < 5000; ++i) {
+        text += std::to_string(i) + "*x + 1\n";
+    }
+    az::ThreadPool pool(4);
+    const az::LoadResult result = az::load_expressions(text, {.grain = 64, .pool = &pool});
+    ASSERT_EQ(result.programs.size(), 5000);
+    EXPECT_TRUE(result.errors.empty());
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(result.programs[i].evaluate(2), 2.0 * i + 1) << i;
+    }
+}
+
+TEST(LoaderTest, ErrorsHaveLineAndOffset) {
+    const std::string text = "x+1\nsin(x\n2*x\n\n3*/x\nx";
+    const az::LoadResult result = az::load_expressions(text, {.grain = 1});
+    ASSERT_EQ(result.programs.size(), 6);
+    ASSERT_EQ(result.errors.size(), 3);
+
+    EXPECT_EQ(result.errors[0].line, 2);
+    EXPECT_GE(result.errors[0].offset, 4);
+    EXPECT_LE(result.errors[0].offset, 10);
+    EXPECT_FALSE(result.errors[0].production.empty());
+    EXPECT_EQ(result.errors[1].line, 4);
+    EXPECT_EQ(result.errors[1].offset, 14);
+    EXPECT_EQ(result.errors[2].line, 5);
+    EXPECT_GE(result.errors[2].offset, 16);
+    EXPECT_LE(result.errors[2].offset, 21);
+
+    EXPECT_TRUE(result.programs[1].empty());
+    EXPECT_TRUE(result.programs[3].empty());
+    EXPECT_TRUE(std::isnan(result.programs[1].evaluate(4)));
+    EXPECT_EQ(result.programs[2].evaluate(4), 8.0);
+    EXPECT_EQ(result.programs[5].evaluate(4), 4.0);
+}
+
+TEST(LoaderTest, MemoryMappedFile) {
+    const std::string path = testing::TempDir() + "az_loader_test.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "sqrt(x)\r\nln(x)\n";
+    }
+    const auto result = az::load_expressions_file(path);
+    std::remove(path.c_str());
+    ASSERT_TRUE(result);
+    ASSERT_EQ(result->programs.size(), 2);
+    EXPECT_TRUE(result->errors.empty());
+    EXPECT_EQ(result->programs[0].evaluate(16), 4.0);
+    EXPECT_TRUE(std::isnan(result->programs[1].evaluate(-1)));
+
+    EXPECT_FALSE(az::load_expressions_file(path));
+}
+
+TEST(LoaderTest, InvalidLinesSurviveCatalogRoundTrip) {
+    const az::LoadResult result = az::load_expressions("x+1\nsin(x\n2*x\n");
+    ASSERT_EQ(result.programs.size(), 3);
+    ASSERT_EQ(result.errors.size(), 1);
+
+    const std::vector<std::byte> bytes = az::save_catalog(result.programs);
+    const auto catalog = az::CatalogView::load(bytes);
+    ASSERT_TRUE(catalog);
+    ASSERT_EQ(catalog->size(), 3);
+    EXPECT_EQ((*catalog)[0].evaluate(4), 5.0);
+    EXPECT_TRUE((*catalog)[1].empty());
+    EXPECT_TRUE(std::isnan((*catalog)[1].evaluate(4)));
+    EXPECT_TRUE((*catalog)[1].to_program().empty());
+    EXPECT_EQ((*catalog)[2].evaluate(4), 8.0);
+
+    const std::vector<double> xs(300, 4.0);
+    std::vector<double> out(xs.size(), 0.0);
+    (*catalog)[1].evaluate_batch(xs, out);
+    EXPECT_TRUE(std::isnan(out.back()));
+}
@@ -0,0 +1,55 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+    constexpr auto Fast = az::NanPolicy::Fast;
+
+    az::Program compiled(const char* expression) {
+        return az::compile(*az::parse_expression(expression));
+    }
+}
+
+TEST(NanPolicyTest, SameResultsInsideDomain) {
+    const az::Program program = compiled("sin(x)^2 + ln(x)/x - sqrt(x)*arctan(x) + cot(x)");
+    for (const double x : {0.25, 0.5, 1.0, 2.0, 10.0}) {
+        EXPECT_DOUBLE_EQ(program.evaluate<Fast>(x), program.evaluate(x)) << x;
+    }
+}
+
+TEST(NanPolicyTest, StrictIsDefault) {
+    const az::Program program = compiled("1/x");
+    EXPECT_TRUE(std::isnan(program.evaluate(0)));
+    EXPECT_TRUE(std::isnan(program.evaluate<az::NanPolicy::Strict>(1e-11)));
+}
+
+TEST(NanPolicyTest, FastFollowsIeee) {
+    EXPECT_EQ(compiled("1/x").evaluate<Fast>(0), INFINITY);
+    EXPECT_EQ(compiled("1/x").evaluate<Fast>(1e-11), 1e11);
+    EXPECT_EQ(compiled("ln(x)").evaluate<Fast>(0), -INFINITY);
+    EXPECT_EQ(compiled("1^x").evaluate<Fast>(NAN), 1.0);
+    EXPECT_TRUE(std::isnan(compiled("sqrt(x)").evaluate<Fast>(-1)));
+    EXPECT_TRUE(std::isnan(compiled("arccos(x)").evaluate<Fast>(2)));
+    EXPECT_TRUE(std::isnan(compiled("x + 1").evaluate<Fast>(NAN)));
+}
+
+TEST(NanPolicyTest, BatchMatchesScalar) {
+    const az::Program program = compiled("1/x + ln(x) + sqrt(x - 1) + arcsin(x) + cot(x)");
+    std::vector<double> xs, fast(600), strict(600);
+    for (int i = 0; i < 600; ++i) {
+        xs.push_back((i - 300) * 0.01);
+    }
+    program.evaluate_batch<Fast>(xs, fast);
+    program.evaluate_batch(xs, strict);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        const double expected = program.evaluate<Fast>(xs[i]);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(fast[i])) << xs[i];
+        } else {
+            EXPECT_DOUBLE_EQ(fast[i], expected) << xs[i];
+        }
+        EXPECT_TRUE(std::isnan(strict[i]) == std::isnan(program.evaluate(xs[i]))) << xs[i];
+    }
+}
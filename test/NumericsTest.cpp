@@ -0,0 +1,108 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/numerics.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace {
+    constexpr double pi = std::numbers::pi;
+}
+
+TEST(NumericsTest, IntegratesSmoothFunctions) {
+    const az::Integral sine = az::integrate(*az::parse_expression("sin(x)"), 0.0, pi);
+    EXPECT_TRUE(sine.converged);
+    EXPECT_NEAR(sine.value, 2.0, 1e-12);
+    EXPECT_LE(sine.error, 2e-10);
+    EXPECT_EQ(sine.undefined, 0.0);
+    // Initial intervals are enough, evaluated in one batch.
+    EXPECT_EQ(sine.evaluations, 8 * 15);
+
+    const az::Integral peak = az::integrate(*az::parse_expression("1/(1 + 10000*x^2)"), -1.0, 1.0);
+    EXPECT_TRUE(peak.converged);
+    EXPECT_NEAR(peak.value, 2 * std::atan(100.0) / 100, 1e-12);
+
+    // Integrable singularity at the end of the range.
+    const az::Integral singular = az::integrate(*az::parse_expression("1/sqrt(x)"), 0.0, 4.0, {.tolerance = 1e-8});
+    EXPECT_TRUE(singular.converged);
+    EXPECT_NEAR(singular.value, 4.0, 1e-7);
+
+    EXPECT_EQ(az::integrate(*az::parse_expression("x"), 1.0, 1.0).value, 0.0);
+}
+
+TEST(NumericsTest, IntegrationExcludesDomainGaps) {
+    // sqrt(1 - x^2) is NaN outside [-1, 1].
+    const az::Integral circle = az::integrate(*az::parse_expression("sqrt(1 - x^2)"), -2.0, 2.0, {.tolerance = 1e-9});
+    EXPECT_NEAR(circle.value, pi / 2, 1e-8);
+    EXPECT_NEAR(circle.undefined, 2.0, 1e-9);
+    EXPECT_FALSE(std::isnan(circle.value));
+
+    const az::Integral logarithm = az::integrate(*az::parse_expression("ln(x)"), -1.0, 1.0, {.tolerance = 1e-9});
+    EXPECT_NEAR(logarithm.value, -1.0, 1e-8);
+    EXPECT_NEAR(logarithm.undefined, 1.0, 1e-9);
+
+    const az::Integral undefined = az::integrate(*az::parse_expression("ln(x)"), -2.0, -1.0);
+    EXPECT_EQ(undefined.value, 0.0);
+    EXPECT_DOUBLE_EQ(undefined.undefined, 1.0);
+}
+
+TEST(NumericsTest, FindsRoots) {
+    const auto cubic = az::parse_expression("x^3 - 2*x - 5");
+    const auto root = az::find_root(*cubic, 2.0, 3.0);
+    ASSERT_TRUE(root);
+    EXPECT_NEAR(*root, 2.0945514815423265, 1e-12);
+    EXPECT_FALSE(az::find_root(*cubic, 3.0, 4.0));
+
+    const std::vector<double> sines = az::find_roots(*az::parse_expression("sin(x)"), -1.0, 10.0);
+    ASSERT_EQ(sines.size(), 4);
+    for (std::size_t k = 0; k < sines.size(); ++k) {
+        EXPECT_NEAR(sines[k], pi * static_cast<double>(k), 1e-12);
+    }
+
+    // Sign changes at poles and across undefined parts are not roots.
+    const std::vector<double> tangent = az::find_roots(*az::parse_expression("tan(x)"), 1.0, 5.0);
+    ASSERT_EQ(tangent.size(), 1);
+    EXPECT_NEAR(tangent[0], pi, 1e-12);
+    EXPECT_FALSE(az::find_root(*az::parse_expression("1/(x - 0.5)"), 0.0, 1.0));
+    EXPECT_TRUE(az::find_roots(*az::parse_expression("ln(x^2 - 1) + 2"), -0.5, 0.5).empty());
+    const std::vector<double> edges = az::find_roots(*az::parse_expression("sqrt(x^2 - 1) - 1"), -3.0, 3.0);
+    ASSERT_EQ(edges.size(), 2);
+    EXPECT_NEAR(edges[0], -std::sqrt(2.0), 1e-12);
+    EXPECT_NEAR(edges[1], std::sqrt(2.0), 1e-12);
+
+    // Inverted bounds are swapped.
+    EXPECT_EQ(az::find_roots(*az::parse_expression("sin(x)"), 10.0, -1.0), sines);
+    ASSERT_TRUE(az::find_root(*cubic, 3.0, 2.0));
+    EXPECT_NEAR(*az::find_root(*cubic, 3.0, 2.0), 2.0945514815423265, 1e-12);
+}
+
+TEST(NumericsTest, FindsGlobalExtrema) {
+    // Many local minima; the global one is at 5.1457.
+    const auto function = az::parse_expression("sin(x) + sin(10*x/3)");
+    const auto minimum = az::minimize(*function, 2.7, 7.5);
+    ASSERT_TRUE(minimum);
+    EXPECT_NEAR(minimum->x, 5.145735, 1e-5);
+    EXPECT_NEAR(minimum->y, -1.899599, 1e-6);
+    EXPECT_LE(minimum->error, 1e-6);
+
+    const auto maximum = az::maximize(*az::parse_expression("x*(4 - x)"), 0.0, 10.0);
+    ASSERT_TRUE(maximum);
+    EXPECT_NEAR(maximum->x, 2.0, 1e-4);
+    EXPECT_NEAR(maximum->y, 4.0, 1e-8);
+
+    // Values out of domain are ignored.
+    const auto edge = az::minimize(*az::parse_expression("sqrt(x) + ln(x + 1)"), -3.0, 3.0);
+    ASSERT_TRUE(edge);
+    EXPECT_NEAR(edge->x, 0.0, 1e-6);
+    EXPECT_NEAR(edge->y, 0.0, 1e-3);
+
+    EXPECT_FALSE(az::minimize(*az::parse_expression("ln(x)"), -2.0, -1.0));
+
+    const auto inverted = az::minimize(*function, 7.5, 2.7);
+    ASSERT_TRUE(inverted);
+    EXPECT_EQ(inverted->x, minimum->x);
+    EXPECT_EQ(inverted->y, minimum->y);
+    const auto inverted_maximum = az::maximize(*az::parse_expression("x*(4 - x)"), 10.0, 0.0);
+    ASSERT_TRUE(inverted_maximum);
+    EXPECT_NEAR(inverted_maximum->x, 2.0, 1e-4);
+}
@@ -0,0 +1,109 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/parallel.hpp>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ParallelTest, SharedTreeAcrossThreads) {
+    const std::shared_ptr<const az::Expression> function = az::parse_expression("sin(x)*x+sqrt(x)");
+    ASSERT_TRUE(function);
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches = 0;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&function, &mismatches, t] {
+            for (int i = 0; i < 10000; ++i) {
+                const double x = t + i * 1e-4;
+                if (function->evaluate(x) != std::sin(x) * x + std::sqrt(x)) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST(ParallelTest, ResultsKeepOrder) {
+    const auto tree = az::parse_expression("1/(x-500)+ln(x)");
+    ASSERT_TRUE(tree);
+    const az::Program program = az::compile(*tree);
+    std::vector<double> xs(100003);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = static_cast<double>(i) * 0.01 - 3;
+    }
+    std::vector<double> out(xs.size());
+    az::ThreadPool pool(4);
+    az::evaluate_parallel(program, xs, out, {.grain = 1000, .pool = &pool});
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        const double expected = tree->evaluate(xs[i]);
+        if (std::isnan(expected)) {
+            ASSERT_TRUE(std::isnan(out[i])) << xs[i];
+        } else {
+            ASSERT_EQ(out[i], expected) << xs[i];
+        }
+    }
+}
+
+TEST(ParallelTest, Range) {
+    const auto tree = az::parse_expression("x*x");
+    ASSERT_TRUE(tree);
+    const az::Program program = az::compile(*tree);
+    std::vector<double> out(1001);
+    az::evaluate_parallel(program, 0.0, 1.0, out, {.grain = 64});
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        const double x = static_cast<double>(i) * 0.001;
+        EXPECT_DOUBLE_EQ(out[i], x * x);
+    }
+}
+
+TEST(ParallelTest, PoolRunsEveryChunkOnce) {
+    az::ThreadPool pool(3);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::atomic<int>> visits(1000);
+        pool.parallel_for(visits.size(), 7, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+        });
+        for (const auto& v: visits) {
+            ASSERT_EQ(v, 1);
+        }
+    }
+}
+
+TEST(ParallelTest, ExceptionsAreRethrownToCaller) {
+    az::ThreadPool pool(4);
+    std::atomic<int> chunks = 0;
+    EXPECT_THROW(pool.parallel_for(100000, 1, [&](const std::size_t begin, std::size_t) {
+        ++chunks;
+        if (begin % 2 == 0) {
+            throw std::runtime_error("chunk failed");
+        }
+    }), std::runtime_error);
+    // Remaining chunks are skipped once a body throws.
+    EXPECT_LT(chunks, 100000);
+
+    std::atomic<std::size_t> sum = 0;
+    pool.parallel_for(1000, 10, [&](const std::size_t begin, const std::size_t end) { sum += end - begin; });
+    EXPECT_EQ(sum, 1000);
+}
+
+TEST(ParallelTest, NestedLoopRunsInline) {
+    az::ThreadPool pool(3);
+    std::vector<std::atomic<int>> visits(100 * 50);
+    pool.parallel_for(100, 1, [&](const std::size_t row, std::size_t) {
+        pool.parallel_for(50, 8, [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                ++visits[row * 50 + i];
+            }
+        });
+    });
+    for (const auto& v: visits) {
+        ASSERT_EQ(v, 1);
+    }
+}
@@ -0,0 +1,586 @@
+#include <az_math/chebyshev.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/fused.hpp>
+#include <az_math/numerics.hpp>
+#include <az_math/program.hpp>
+#include <az_math/sampler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+/**
+ * Benchmarks of parse and evaluate hot paths over a seeded, reproducible corpus. Results are written to
+ * stdout as JSON (default) or CSV; NaN and infinite values are written as null in JSON:
+ *
+ *   parser_bench [--format=json|csv] [--seed=N]
+ */
+
+namespace {
+    std::atomic<std::uint64_t> allocations{0};
+}
+
+void* operator new(const std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    struct Result {
+        std::string benchmark;
+        std::string name;
+        std::string metric;
+        double value;
+        std::string unit;
+    };
+
+    class Corpus {
+    public:
+        explicit Corpus(const std::uint32_t seed) : random_(seed) {}
+
+        std::string number() {
+            std::string result = std::to_string(between(0, 999));
+            if (random_() % 2) {
+                result += "." + std::to_string(between(0, 9999));
+            }
+            return result;
+        }
+
+        // c0 + c1*x + c2*x^2 + ... with 2 to 8 terms
+        std::string polynomial() {
+            const int degree = between(1, 7);
+            std::string result = number();
+            for (int i = 1; i <= degree; ++i) {
+                result += " + " + number() + "*x^" + std::to_string(i);
+            }
+            return result;
+        }
+
+        // sin(ln(cos(... x ...))) with 8 to 24 nested calls mixed with arithmetic
+        std::string nested() {
+            static constexpr const char* functions[] = {"sin", "cos", "tan", "ln", "lg", "sqrt", "arctan"};
+            const int depth = between(8, 24);
+            std::string result = "x";
+            for (int i = 0; i < depth; ++i) {
+                result = std::string(functions[random_() % std::size(functions)]) + "(" + result + ")";
+                if (random_() % 3 == 0) {
+                    result = "(" + result + " * " + number() + " + x)";
+                }
+            }
+            return result;
+        }
+
+        // sum of 200 to 1000 terms
+        std::string long_sum() {
+            const int terms = between(200, 1000);
+            std::string result = number() + "*x";
+            for (int i = 1; i < terms; ++i) {
+                result += (random_() % 2 ? " + " : " - ") + number() + (random_() % 2 ? "*x" : "");
+            }
+            return result;
+        }
+
+    private:
+        // Output of std::mt19937 is fixed by the standard, unlike that of distributions, so the corpus of a
+        // seed is the same with every standard library.
+        int between(const int lo, const int hi) {
+            return lo + static_cast<int>(random_() % static_cast<std::uint32_t>(hi - lo + 1));
+        }
+
+        std::mt19937 random_;
+    };
+
+    template<typename F>
+    double seconds(const int repetitions, F&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; ++i) {
+            f();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+    }
+
+    template<typename T>
+    void keep(const T& value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    void parse_benchmarks(Corpus& corpus, std::vector<Result>& results) {
+        struct Set {
+            const char* name;
+            std::string (Corpus::*make)();
+            int count;
+        };
+        constexpr Set sets[] = {
+            {"polynomial", &Corpus::polynomial, 20000},
+            {"nested", &Corpus::nested, 5000},
+            {"long_sum", &Corpus::long_sum, 200},
+        };
+        for (const auto& [name, make, count] : sets) {
+            std::vector<std::string> expressions;
+            std::size_t bytes = 0;
+            for (int i = 0; i < count; ++i) {
+                expressions.push_back((corpus.*make)());
+                bytes += expressions.back().size();
+            }
+
+            const std::uint64_t before = allocations.load();
+            const double time = seconds(5, [&] {
+                for (const auto& e : expressions) {
+                    keep(az::parse_expression(e));
+                }
+            });
+            const double parses = 5.0 * count;
+            const double per_parse = static_cast<double>(allocations.load() - before) / parses;
+
+            results.push_back({"parse", name, "time", time / count * 1e9, "ns/expression"});
+            results.push_back({"parse", name, "throughput", static_cast<double>(bytes) / time / 1e6, "MB/s"});
+            results.push_back({"parse", name, "allocations", per_parse, "allocations/expression"});
+
+            const double compile = seconds(5, [&] {
+                for (const auto& e : expressions) {
+                    keep(az::compile(*az::parse_expression(e)));
+                }
+            });
+            results.push_back({"parse+compile", name, "time", compile / count * 1e9, "ns/expression"});
+        }
+    }
+
+    void evaluate_benchmarks(std::vector<Result>& results) {
+        struct Case {
+            const char* kind;
+            const char* expression;
+        };
+        // Each case differs from the "x" baseline by a single node of the measured kind.
+        constexpr Case cases[] = {
+            {"X", "x"}, {"Number", "2"}, {"Negative", "-x"}, {"Plus", "x+x"}, {"Minus", "x-x"}, {"Mul", "x*x"},
+            {"Div", "x/x"}, {"Pow", "x^x"}, {"Sin", "sin(x)"}, {"Cos", "cos(x)"}, {"Tan", "tan(x)"},
+            {"Cot", "cot(x)"}, {"Sqrt", "sqrt(x)"}, {"Cbrt", "cbrt(x)"}, {"Ln", "ln(x)"}, {"Lg", "lg(x)"},
+            {"Log", "log(x)"}, {"Arcsin", "arcsin(x)"}, {"Arccos", "arccos(x)"}, {"Arctan", "arctan(x)"},
+        };
+        constexpr int calls = 1 << 20;
+        for (const auto& [kind, expression] : cases) {
+            const auto tree = az::parse_expression(expression);
+            const az::Program program = az::compile(*tree);
+            double x = 0.25;
+            const double tree_time = seconds(1, [&] {
+                for (int i = 0; i < calls; ++i) {
+                    x = 0.25 + tree->evaluate(x) * 1e-300;
+                }
+            });
+            const double program_time = seconds(1, [&] {
+                for (int i = 0; i < calls; ++i) {
+                    x = 0.25 + program.evaluate(x) * 1e-300;
+                }
+            });
+            const double fast_time = seconds(1, [&] {
+                for (int i = 0; i < calls; ++i) {
+                    x = 0.25 + program.evaluate<az::NanPolicy::Fast>(x) * 1e-300;
+                }
+            });
+            keep(x);
+            results.push_back({"evaluate_tree", kind, "time", tree_time / calls * 1e9, "ns/call"});
+            results.push_back({"evaluate_program", kind, "time", program_time / calls * 1e9, "ns/call"});
+            results.push_back({"evaluate_program_fast", kind, "time", fast_time / calls * 1e9, "ns/call"});
+        }
+    }
+
+    void batch_benchmarks(Corpus& corpus, std::vector<Result>& results) {
+        struct Case {
+            const char* name;
+            std::string expression;
+        };
+        const Case cases[] = {
+            {"polynomial", corpus.polynomial()},
+            {"nested", corpus.nested()},
+            {"long_sum", corpus.long_sum()},
+        };
+        std::vector<double> xs(1 << 16);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            xs[i] = 0.001 + static_cast<double>(i) / static_cast<double>(xs.size());
+        }
+        std::vector<double> out(xs.size());
+        for (const auto& [name, expression] : cases) {
+            const az::Program program = az::compile(*az::parse_expression(expression));
+            const double time = seconds(10, [&] {
+                program.evaluate_batch(xs, out);
+                keep(out);
+            });
+            const double fast = seconds(10, [&] {
+                program.evaluate_batch<az::NanPolicy::Fast>(xs, out);
+                keep(out);
+            });
+            const double size = static_cast<double>(xs.size());
+            results.push_back({"evaluate_batch", name, "throughput", size / time / 1e6, "M evaluations/s"});
+            results.push_back({"evaluate_batch", name, "time", time / size / static_cast<double>(
+                                   program.instructions().size()) * 1e9, "ns/instruction"});
+            results.push_back({"evaluate_batch_fast", name, "throughput", size / fast / 1e6, "M evaluations/s"});
+
+            const az::BasicProgram<float> single(program);
+            const std::vector<float> xs_float(xs.begin(), xs.end());
+            std::vector<float> out_float(xs.size());
+            const double float_time = seconds(10, [&] {
+                single.evaluate_batch(xs_float, out_float);
+                keep(out_float);
+            });
+            results.push_back({"evaluate_batch_float", name, "throughput", size / float_time / 1e6,
+                               "M evaluations/s"});
+        }
+    }
+
+    /**
+     * Evenly spaced points of [lo, hi] in xs and function values in ys.
+     */
+    void sample_uniform(const az::Program& program, const double lo, const double hi, std::vector<double>& xs,
+                        std::vector<double>& ys) {
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            xs[i] = lo + (hi - lo) * static_cast<double>(i) / static_cast<double>(xs.size() - 1);
+        }
+        program.evaluate_batch(xs, ys);
+    }
+
+    void sampling_benchmarks(std::vector<Result>& results) {
+        struct Case {
+            const char* name;
+            const char* expression;
+        };
+        constexpr Case cases[] = {
+            {"smooth", "sin(x)*x + 0.1*x^2"},
+            {"poles", "cot(x)"},
+            {"domain_edges", "sqrt(25 - x^2) + ln(x + 7)"},
+        };
+        constexpr double lo = -10.0;
+        constexpr double hi = 10.0;
+        const az::SamplerOptions options{.tolerance = 1e-3, .max_points = 1 << 14};
+        for (const auto& [name, expression] : cases) {
+            const auto tree = az::parse_expression(expression);
+            const az::Program program = az::compile(*tree);
+
+            az::Sampled adaptive;
+            const double adaptive_time = seconds(20, [&] {
+                adaptive = az::sample(*tree, lo, hi, options);
+                keep(adaptive);
+            });
+
+            // Smallest grid, doubled from 65 points, where every sample is within tolerance of the chord of
+            // its neighbours in the same sense as the adaptive sampler checks it. Grids near poles never get
+            // there and stop at the cap.
+            std::vector<double> xs(65);
+            std::vector<double> ys(xs.size());
+            for (;;) {
+                sample_uniform(program, lo, hi, xs, ys);
+                double error = 0.0;
+                for (std::size_t i = 1; i + 1 < xs.size(); ++i) {
+                    const double chord = (ys[i - 1] + ys[i + 1]) / 2;
+                    if (std::isfinite(chord) && std::isfinite(ys[i])) {
+                        error = std::max(error, std::abs(ys[i] - chord) / 4);
+                    }
+                }
+                if (error <= options.tolerance || xs.size() > (1 << 20)) {
+                    break;
+                }
+                xs.resize(xs.size() * 2 - 1);
+                ys.resize(xs.size());
+            }
+            const double uniform_time = seconds(20, [&] {
+                sample_uniform(program, lo, hi, xs, ys);
+                keep(ys);
+            });
+
+            results.push_back({"sample_adaptive", name, "points", static_cast<double>(adaptive.evaluations),
+                               "evaluations"});
+            results.push_back({"sample_adaptive", name, "time", adaptive_time * 1e6, "us"});
+            results.push_back({"sample_uniform", name, "points", static_cast<double>(xs.size()), "evaluations"});
+            results.push_back({"sample_uniform", name, "time", uniform_time * 1e6, "us"});
+        }
+    }
+
+    /**
+     * Batch evaluation of piecewise Chebyshev approximations against the programs they replace. Random
+     * nested chains of the corpus are mostly NaN with dense poles, so a fixed smooth chain is used instead.
+     */
+    void approximation_benchmarks(Corpus& corpus, std::vector<Result>& results) {
+        struct Case {
+            const char* name;
+            std::string expression;
+        };
+        const Case cases[] = {
+            {"polynomial", corpus.polynomial()},
+            {"smooth_chain", "sin(cos(arctan(ln(sqrt(x + 2) + 1) * 3) + x) * 2 + sqrt(x + 1)) * lg(x + 3)"},
+            {"long_sum", corpus.long_sum()},
+        };
+        constexpr double lo = 0.001;
+        constexpr double hi = 1.001;
+        std::vector<double> xs(1 << 16);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            xs[i] = lo + static_cast<double>(i) / static_cast<double>(xs.size());
+        }
+        std::vector<double> out(xs.size());
+        for (const auto& [name, expression] : cases) {
+            const auto tree = az::parse_expression(expression);
+            std::optional<az::Approximation> approximation;
+            const double fit_time = seconds(3, [&] {
+                approximation = az::approximate(*tree, lo, hi, 1e-10);
+                keep(approximation);
+            });
+            const double time = seconds(10, [&] {
+                approximation->evaluate_batch(xs, out);
+                keep(out);
+            });
+            const double size = static_cast<double>(xs.size());
+            results.push_back({"approximate", name, "time", fit_time * 1e6, "us"});
+            results.push_back({"approximate", name, "pieces", static_cast<double>(approximation->size()), "pieces"});
+            results.push_back({"approximate", name, "error", approximation->error(), "relative"});
+            results.push_back({"evaluate_approximation", name, "throughput", size / time / 1e6,
+                               "M evaluations/s"});
+            const az::Program program = az::compile(*tree);
+            const double program_time = seconds(10, [&] {
+                program.evaluate_batch(xs, out);
+                keep(out);
+            });
+            results.push_back({"evaluate_approximation", name, "program_throughput", size / program_time / 1e6,
+                               "M evaluations/s"});
+        }
+    }
+
+    void numerics_benchmarks(std::vector<Result>& results) {
+        const auto smooth = az::parse_expression("sin(x)*x + 0.1*x^2");
+        const auto gaps = az::parse_expression("sqrt(25 - x^2) + ln(x + 7)");
+        const auto oscillating = az::parse_expression("sin(x) + sin(10*x/3)");
+        constexpr double lo = -10.0;
+        constexpr double hi = 10.0;
+
+        az::Integral integral;
+        const double smooth_time = seconds(20, [&] {
+            integral = az::integrate(*smooth, lo, hi);
+            keep(integral);
+        });
+        results.push_back({"integrate", "smooth", "time", smooth_time * 1e6, "us"});
+        results.push_back({"integrate", "smooth", "points", static_cast<double>(integral.evaluations), "evaluations"});
+        const double gaps_time = seconds(20, [&] {
+            integral = az::integrate(*gaps, lo, hi);
+            keep(integral);
+        });
+        results.push_back({"integrate", "domain_edges", "time", gaps_time * 1e6, "us"});
+        results.push_back({"integrate", "domain_edges", "points", static_cast<double>(integral.evaluations),
+                           "evaluations"});
+
+        std::vector<double> roots;
+        const double roots_time = seconds(20, [&] {
+            roots = az::find_roots(*oscillating, lo, hi);
+            keep(roots);
+        });
+        results.push_back({"find_roots", "oscillating", "time", roots_time * 1e6, "us"});
+        results.push_back({"find_roots", "oscillating", "roots", static_cast<double>(roots.size()), "roots"});
+
+        std::optional<az::Extremum> minimum;
+        const double minimum_time = seconds(5, [&] {
+            minimum = az::minimize(*oscillating, lo, hi);
+            keep(minimum);
+        });
+        results.push_back({"minimize", "oscillating", "time", minimum_time * 1e6, "us"});
+        if (minimum) {
+            results.push_back({"minimize", "oscillating", "points", static_cast<double>(minimum->evaluations),
+                               "evaluations"});
+        }
+    }
+
+    /**
+     * Dashboard-like set of formulas over one grid, built from a few shared subterms, evaluated as separate
+     * programs and as one fused program.
+     */
+    void fused_benchmarks(std::vector<Result>& results) {
+        static constexpr const char* terms[] = {"sin(x)", "x^2", "cos(x)", "sqrt(x)", "ln(x + 1)", "x^3"};
+        constexpr std::size_t formulas = 200;
+        std::vector<std::shared_ptr<az::Expression>> expressions;
+        for (std::size_t i = 0; i < formulas; ++i) {
+            const std::string formula = std::to_string(i + 1) + "*" + terms[i % 6] + " + " + terms[(i / 6) % 6]
+                                        + "/" + std::to_string(i % 7 + 2) + " - " + terms[(i / 36 + 1) % 6];
+            expressions.push_back(az::parse_expression(formula));
+        }
+        std::vector<double> xs(1 << 14);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            xs[i] = 0.001 + static_cast<double>(i) / static_cast<double>(xs.size());
+        }
+        std::vector<std::vector<double>> columns(formulas, std::vector<double>(xs.size()));
+        std::vector<std::span<double>> spans(columns.begin(), columns.end());
+
+        std::vector<az::Program> programs;
+        for (const auto& expression : expressions) {
+            programs.push_back(az::compile(*expression));
+        }
+        const double separate = seconds(5, [&] {
+            for (std::size_t i = 0; i < formulas; ++i) {
+                programs[i].evaluate_batch(xs, spans[i]);
+            }
+            keep(columns);
+        });
+        const az::FusedProgram fused = az::compile_fused(expressions);
+        const double fused_time = seconds(5, [&] {
+            fused.evaluate_batch(xs, spans);
+            keep(columns);
+        });
+        const double evaluations = static_cast<double>(xs.size() * formulas);
+        results.push_back({"evaluate_separate", "dashboard", "throughput", evaluations / separate / 1e6,
+                           "M evaluations/s"});
+        results.push_back({"evaluate_fused", "dashboard", "throughput", evaluations / fused_time / 1e6,
+                           "M evaluations/s"});
+        results.push_back({"evaluate_fused", "dashboard", "instructions",
+                           static_cast<double>(fused.instructions().size()), "instructions"});
+        results.push_back({"evaluate_fused", "dashboard", "nodes_before", static_cast<double>(fused.nodes_before()),
+                           "nodes"});
+    }
+
+    void number_benchmarks(Corpus& corpus, std::vector<Result>& results) {
+        std::vector<std::string> numbers;
+        for (int i = 0; i < 200000; ++i) {
+            numbers.push_back(corpus.number());
+        }
+        const auto count = static_cast<double>(numbers.size());
+
+        double total = 0.0;
+        const double stod = seconds(5, [&] {
+            for (const auto& n : numbers) {
+                const auto period = n.find('.');
+                const auto fraction = period == std::string::npos
+                                          ? std::optional<std::string>()
+                                          : std::optional<std::string>(n.substr(period + 1));
+                total += az::Number(n.substr(0, period), fraction).value;
+            }
+        });
+        const double from_chars = seconds(5, [&] {
+            for (const auto& n : numbers) {
+                double value = 0.0;
+                std::from_chars(n.data(), n.data() + n.size(), value);
+                total += value;
+            }
+        });
+        keep(total);
+        results.push_back({"number", "concatenate+stod", "time", stod / count * 1e9, "ns/number"});
+        results.push_back({"number", "from_chars", "time", from_chars / count * 1e9, "ns/number"});
+
+        // Expressions held as views into one buffer, parsed in place or copied into std::string first.
+        std::string buffer;
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        for (int i = 0; i < 20000; ++i) {
+            const std::string e = corpus.polynomial();
+            ranges.emplace_back(buffer.size(), e.size());
+            buffer += e;
+        }
+        const double copied = seconds(5, [&] {
+            for (const auto& [begin, size] : ranges) {
+                keep(az::parse_expression(std::string(buffer, begin, size)));
+            }
+        });
+        const double viewed = seconds(5, [&] {
+            for (const auto& [begin, size] : ranges) {
+                keep(az::parse_expression(std::string_view(buffer).substr(begin, size)));
+            }
+        });
+        const auto expressions = static_cast<double>(ranges.size());
+        results.push_back({"parse_input", "std::string copy", "time", copied / expressions * 1e9, "ns/expression"});
+        results.push_back({"parse_input", "std::string_view", "time", viewed / expressions * 1e9, "ns/expression"});
+    }
+
+    double peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#else
+        return static_cast<double>(usage.ru_maxrss);
+#endif
+#else
+        return 0.0;
+#endif
+    }
+
+    void print_json(const std::uint32_t seed, const std::vector<Result>& results) {
+        std::printf("{\n  \"seed\": %u,\n  \"results\": [\n", seed);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            // JSON has no NaN or infinity.
+            char value[32] = "null";
+            if (std::isfinite(r.value)) {
+                std::snprintf(value, sizeof(value), "%.6g", r.value);
+            }
+            std::printf("    {\"benchmark\": \"%s\", \"case\": \"%s\", \"metric\": \"%s\", \"value\": %s, "
+                        "\"unit\": \"%s\"}%s\n", r.benchmark.c_str(), r.name.c_str(), r.metric.c_str(), value,
+                        r.unit.c_str(), i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+    void print_csv(const std::vector<Result>& results) {
+        std::printf("benchmark,case,metric,value,unit\n");
+        for (const Result& r : results) {
+            std::printf("%s,%s,%s,%.6g,%s\n", r.benchmark.c_str(), r.name.c_str(), r.metric.c_str(), r.value,
+                        r.unit.c_str());
+        }
+    }
+}
+
+int main(const int argc, char** argv) {
+    bool csv = false;
+    std::uint32_t seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--format=csv") {
+            csv = true;
+        } else if (arg == "--format=json") {
+            csv = false;
+        } else if (arg.starts_with("--seed=")) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[i] + 7, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: %s [--format=json|csv] [--seed=N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Corpus corpus(seed);
+    std::vector<Result> results;
+    parse_benchmarks(corpus, results);
+    evaluate_benchmarks(results);
+    batch_benchmarks(corpus, results);
+    sampling_benchmarks(results);
+    approximation_benchmarks(corpus, results);
+    numerics_benchmarks(results);
+    fused_benchmarks(results);
+    number_benchmarks(corpus, results);
+    results.push_back({"process", "all", "peak_rss", peak_rss_kb(), "KiB"});
+
+    if (csv) {
+        print_csv(results);
+    } else {
+        print_json(seed, results);
+    }
+}
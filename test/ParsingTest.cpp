@@ -1,5 +1,7 @@
 #include <az_math/function_parser.hpp>
 #include <gtest/gtest.h>
+#include <limits>
+#include <string>
 
 #include "lexy/dsl.hpp"
 #include "lexy_ext/report_error.hpp"
@@ -13,6 +15,18 @@ TEST(ParsingTest, ParseNumber) {
     EXPECT_DOUBLE_EQ(decimalResult->evaluate(0), 3.14);
 }
 
+TEST(ParsingTest, NumbersOutOfRange) {
+    const auto huge = az::parse_expression(std::string(400, '9') + "+x");
+    ASSERT_TRUE(huge);
+    EXPECT_EQ(huge->evaluate(1), std::numeric_limits<double>::infinity());
+    const auto tiny = az::parse_expression("0." + std::string(400, '0') + "1+x");
+    ASSERT_TRUE(tiny);
+    EXPECT_EQ(tiny->evaluate(1), 1.0);
+    const auto large = az::parse_expression("1" + std::string(300, '0'));
+    ASSERT_TRUE(large);
+    EXPECT_DOUBLE_EQ(large->evaluate(0), 1e300);
+}
+
 TEST(ParsingTest, ParseX) {
     auto result = az::parse_expression("x");
     ASSERT_TRUE(result);
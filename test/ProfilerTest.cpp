@@ -0,0 +1,68 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/profiler.hpp>
+#include <az_math/program.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+
+TEST(ProfilerTest, CountsEveryInstructionOncePerEvaluation) {
+    const az::Program program = az::compile(*az::parse_expression("-(x+1)/(x-1)"));
+    az::Profiler profiler(program);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(profiler.evaluate(i + 2), program.evaluate(i + 2));
+    }
+    const az::ProfileReport& report = profiler.report();
+    EXPECT_EQ(report.evaluations, 10);
+    ASSERT_EQ(report.instructions.size(), program.instructions().size());
+    for (std::size_t i = 0; i < report.instructions.size(); ++i) {
+        EXPECT_EQ(report.instructions[i].op, program.instructions()[i].op);
+        EXPECT_EQ(report.instructions[i].calls, 10);
+    }
+    EXPECT_FALSE(report.first_nan);
+
+    const auto kinds = report.by_kind();
+    const auto x = std::find_if(kinds.begin(), kinds.end(), [](const auto& k) { return k.op == az::Kind::X; });
+    ASSERT_NE(x, kinds.end());
+    EXPECT_EQ(x->calls, 20);
+}
+
+TEST(ProfilerTest, FindsNanOrigin) {
+    const az::Program program = az::compile(*az::parse_expression("sin(x) + sqrt(x - 3) * 2"));
+    az::Profiler profiler(program);
+    EXPECT_FALSE(std::isnan(profiler.evaluate(4)));
+    EXPECT_TRUE(std::isnan(profiler.evaluate(1)));
+    EXPECT_TRUE(std::isnan(profiler.evaluate(0)));
+
+    const auto& origin = profiler.report().first_nan;
+    ASSERT_TRUE(origin);
+    EXPECT_EQ(origin->op, az::Kind::Sqrt);
+    EXPECT_EQ(origin->reason, az::NanReason::NegativeSqrt);
+    EXPECT_EQ(origin->lhs, -2.0);
+    EXPECT_EQ(origin->evaluation, 1);
+    EXPECT_EQ(origin->arguments, std::vector<double>{1.0});
+    EXPECT_EQ(az::to_string(origin->reason), "negative_sqrt");
+}
+
+TEST(ProfilerTest, Reasons) {
+    const auto reason = [](const char* expression, const double x) {
+        az::Profiler profiler(az::compile(*az::parse_expression(expression)));
+        (void) profiler.evaluate(x);
+        return profiler.report().first_nan->reason;
+    };
+    EXPECT_EQ(reason("1/(x-2)", 2), az::NanReason::DivisionByZero);
+    EXPECT_EQ(reason("ln(x)", 0), az::NanReason::NonPositiveLogarithm);
+    EXPECT_EQ(reason("lg(x)", -1), az::NanReason::NonPositiveLogarithm);
+    EXPECT_EQ(reason("cot(x)", 0), az::NanReason::CotangentPole);
+    EXPECT_EQ(reason("arccos(x)", 2), az::NanReason::ArccosDomain);
+    EXPECT_EQ(reason("x^0.5", -4), az::NanReason::PowDomain);
+    EXPECT_EQ(reason("x+1", std::nan("")), az::NanReason::NanArgument);
+}
+
+TEST(ProfilerTest, ResetClearsReport) {
+    const az::Program program = az::compile(*az::parse_expression("ln(x)"));
+    az::Profiler profiler(program);
+    (void) profiler.evaluate(-1);
+    profiler.reset();
+    EXPECT_EQ(profiler.report().evaluations, 0);
+    EXPECT_FALSE(profiler.report().first_nan);
+    EXPECT_EQ(profiler.report().instructions[0].calls, 0);
+}
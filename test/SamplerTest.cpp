@@ -0,0 +1,106 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/sampler.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace {
+    constexpr double pi = std::numbers::pi;
+
+    /**
+     * Largest distance between the function and the polyline, checked at points between the samples.
+     */
+    double max_error(const az::Expression& function, const std::vector<az::SamplePoint>& segment) {
+        double error = 0.0;
+        for (std::size_t i = 0; i + 1 < segment.size(); ++i) {
+            const az::SamplePoint a = segment[i];
+            const az::SamplePoint b = segment[i + 1];
+            for (int k = 1; k < 8; ++k) {
+                const double x = a.x + (b.x - a.x) * k / 8;
+                const double line = a.y + (b.y - a.y) * k / 8;
+                error = std::max(error, std::abs(function.evaluate(x) - line));
+            }
+        }
+        return error;
+    }
+}
+
+TEST(SamplerTest, RefinesOnlyWhereCurved) {
+    const auto line = az::parse_expression("2*x + 1");
+    const az::Sampled straight = az::sample(*line, -10.0, 10.0);
+    EXPECT_EQ(straight.evaluations, 65);
+    ASSERT_EQ(straight.segments.size(), 1);
+    EXPECT_EQ(straight.segments[0].front().x, -10.0);
+    EXPECT_EQ(straight.segments[0].back().x, 10.0);
+
+    const auto sine = az::parse_expression("sin(x)");
+    const az::Sampled curve = az::sample(*sine, 0.0, 2 * pi, {.tolerance = 1e-4});
+    ASSERT_EQ(curve.segments.size(), 1);
+    EXPECT_GT(curve.evaluations, 65);
+    // Uniform grid with the same error would need about 2*pi / sqrt(8 * 1e-4) = 222 points.
+    EXPECT_LT(curve.evaluations, 300);
+    EXPECT_LT(max_error(*sine, curve.segments[0]), 2e-4);
+    for (std::size_t i = 1; i < curve.segments[0].size(); ++i) {
+        EXPECT_LT(curve.segments[0][i - 1].x, curve.segments[0][i].x);
+    }
+}
+
+TEST(SamplerTest, SplitsAtPoles) {
+    const az::Sampled tangent = az::sample(*az::parse_expression("tan(x)"), -3.0, 3.0);
+    ASSERT_EQ(tangent.segments.size(), 3);
+    EXPECT_NEAR(tangent.segments[0].back().x, -pi / 2, 1e-6);
+    EXPECT_NEAR(tangent.segments[1].front().x, -pi / 2, 1e-6);
+    EXPECT_NEAR(tangent.segments[2].front().x, pi / 2, 1e-6);
+    for (const auto& segment : tangent.segments) {
+        for (std::size_t i = 1; i < segment.size(); ++i) {
+            EXPECT_LT(segment[i - 1].y, segment[i].y);
+        }
+    }
+
+    // Pole between two grid points of the initial grid.
+    const az::Sampled reciprocal = az::sample(*az::parse_expression("1/(x-0.3)"), -1.0, 1.0, {.initial_points = 5});
+    ASSERT_EQ(reciprocal.segments.size(), 2);
+    EXPECT_LT(reciprocal.segments[0].back().y, -1e3);
+    EXPECT_GT(reciprocal.segments[1].front().y, 1e3);
+}
+
+TEST(SamplerTest, LocatesDomainEdges) {
+    const az::Sampled circle = az::sample(*az::parse_expression("sqrt(1 - x^2)"), -2.0, 2.0);
+    ASSERT_EQ(circle.segments.size(), 1);
+    EXPECT_NEAR(circle.segments[0].front().x, -1.0, 1e-8);
+    EXPECT_NEAR(circle.segments[0].back().x, 1.0, 1e-8);
+
+    const az::Sampled undefined = az::sample(*az::parse_expression("ln(x)"), -2.0, -1.0);
+    EXPECT_TRUE(undefined.segments.empty());
+    EXPECT_EQ(undefined.evaluations, 65);
+
+    const az::Sampled islands = az::sample(*az::parse_expression("sqrt(sin(x))"), 0.0, 4 * pi);
+    EXPECT_EQ(islands.segments.size(), 2);
+}
+
+TEST(SamplerTest, RespectsBudget) {
+    const auto function = az::parse_expression("sin(50*x)/x");
+    const az::Sampled result = az::sample(*function, 0.1, 10.0, {.tolerance = 1e-6, .max_points = 500});
+    EXPECT_EQ(result.evaluations, 500);
+    std::size_t points = 0;
+    for (const auto& segment : result.segments) {
+        points += segment.size();
+    }
+    EXPECT_EQ(points, 500);
+}
+
+TEST(SamplerTest, SwapsInvertedBounds) {
+    const auto function = az::parse_expression("1/x");
+    const az::Sampled forward = az::sample(*function, -1.0, 1.0);
+    const az::Sampled inverted = az::sample(*function, 1.0, -1.0);
+    EXPECT_EQ(inverted.evaluations, forward.evaluations);
+    ASSERT_EQ(inverted.segments.size(), 2);
+    ASSERT_EQ(inverted.segments.size(), forward.segments.size());
+    for (std::size_t s = 0; s < forward.segments.size(); ++s) {
+        ASSERT_EQ(inverted.segments[s].size(), forward.segments[s].size());
+        for (std::size_t i = 0; i < forward.segments[s].size(); ++i) {
+            EXPECT_EQ(inverted.segments[s][i].x, forward.segments[s][i].x);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <az_math/tree.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+    az::Program compiled(const char* expression) {
+        return az::compile(*az::parse_expression(expression));
+    }
+}
+
+TEST(ScalarTypeTest, NodesApplyInEveryType) {
+    static_assert(std::is_same_v<decltype(az::Sin::apply(1.0f)), float>);
+    static_assert(std::is_same_v<decltype(az::Pow::apply(1.0L, 2.0L)), long double>);
+    EXPECT_EQ(az::Sqrt::apply(4.0f), 2.0f);
+    EXPECT_EQ(az::Div::apply(1.0L, 4.0L), 0.25L);
+    EXPECT_TRUE(std::isnan(az::Ln::apply(-1.0f)));
+    EXPECT_EQ(az::apply(az::Kind::Negative, 2.0f), -2.0f);
+}
+
+TEST(ScalarTypeTest, DomainEpsilonScalesWithType) {
+    // 1e-6 is far from zero for double but within the float threshold.
+    EXPECT_EQ(az::Div::apply(1.0, 1e-6), 1e6);
+    EXPECT_TRUE(std::isnan(az::Div::apply(1.0f, 1e-6f)));
+    EXPECT_FALSE(std::isnan(az::Div::apply(1.0L, 1e-12L)));
+    EXPECT_TRUE(std::isnan(az::Cot::apply(std::numbers::pi_v<float>)));
+}
+
+TEST(ScalarTypeTest, FloatProgram) {
+    const az::Program program = compiled("sin(x)^2 + 0.1*x/(x+1)");
+    const az::BasicProgram<float> single(program);
+    for (const float x : {0.5f, 1.0f, 2.0f, 7.5f}) {
+        static_assert(std::is_same_v<decltype(single.evaluate(x)), float>);
+        EXPECT_NEAR(single.evaluate(x), program.evaluate(x), 1e-6) << x;
+    }
+    EXPECT_TRUE(std::isnan(single.evaluate(-1.0f)));
+}
+
+TEST(ScalarTypeTest, LongDoubleProgram) {
+    const az::BasicProgram<long double> program(compiled("1/3 + x"));
+    EXPECT_EQ(program.evaluate(0.0L), 1.0L / 3.0L);
+    EXPECT_NE(program.evaluate(0.0L), static_cast<long double>(1.0 / 3.0));
+}
+
+namespace {
+    template<typename T>
+    void expectBatchMatchesScalar(const char* expression) {
+        const az::BasicProgram<T> program(compiled(expression));
+        std::vector<T> xs;
+        for (int i = 0; i < 1000; ++i) {
+            xs.push_back(static_cast<T>(i - 500) / 100);
+        }
+        std::vector<T> out(xs.size());
+        program.evaluate_batch(xs, out);
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            const T expected = program.evaluate(xs[i]);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(out[i])) << xs[i];
+            } else {
+                EXPECT_EQ(out[i], expected) << xs[i];
+            }
+        }
+        program.template evaluate_batch<az::NanPolicy::Fast>(xs, out);
+        EXPECT_EQ(out[600], program.template evaluate<az::NanPolicy::Fast>(xs[600]));
+    }
+}
+
+TEST(ScalarTypeTest, BatchInEveryType) {
+    const char* expression = "-x + x*x - 3/x + sqrt(x) + ln(x) + cot(x)";
+    expectBatchMatchesScalar<float>(expression);
+    expectBatchMatchesScalar<double>(expression);
+    expectBatchMatchesScalar<long double>(expression);
+}
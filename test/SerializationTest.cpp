@@ -0,0 +1,127 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/loader.hpp>
+#include <az_math/program.hpp>
+#include <az_math/serialize.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+    az::Program compiled(const std::string& expression) {
+        return az::compile(*az::parse_expression(expression));
+    }
+}
+
+TEST(SerializationTest, RoundTripEvaluatesTheSame) {
+    const az::Program program = compiled("sin(x)^2 + 2.5*ln(x) - 2.5/x");
+    const std::vector<std::byte> bytes = az::save_program(program);
+    const auto view = az::ProgramView::load(bytes);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(view->size(), program.instructions().size());
+    EXPECT_EQ(view->registers(), program.registers());
+    for (const double x : {0.5, 1.0, 3.0, -1.0}) {
+        const double expected = program.evaluate(x);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(view->evaluate(x)));
+        } else {
+            EXPECT_EQ(view->evaluate(x), expected);
+        }
+    }
+
+    std::vector<double> xs, out(100), expected(100);
+    for (int i = 0; i < 100; ++i) xs.push_back(0.1 * (i + 1));
+    view->evaluate_batch(xs, out);
+    program.evaluate_batch(xs, expected);
+    EXPECT_EQ(out, expected);
+    EXPECT_EQ(view->to_program().evaluate(2), program.evaluate(2));
+}
+
+TEST(SerializationTest, ConstantsArePooled) {
+    const az::Program program = compiled("1.5*x + 1.5*x^2 + 1.5");
+    const std::vector<std::byte> bytes = az::save_program(program);
+    // 24 header bytes, 16 per instruction and the constants 1.5 and 2 only.
+    EXPECT_EQ(bytes.size(), 24 + 16 * program.instructions().size() + 2 * sizeof(double));
+}
+
+TEST(SerializationTest, LittleEndianHeader) {
+    const std::vector<std::byte> bytes = az::save_program(compiled("x+1"));
+    EXPECT_EQ(static_cast<char>(bytes[0]), 'A');
+    EXPECT_EQ(static_cast<char>(bytes[3]), 'R');
+    EXPECT_EQ(bytes[4], std::byte{1});
+    EXPECT_EQ(bytes[5], std::byte{0});
+}
+
+TEST(SerializationTest, VariablesSurvive) {
+    const az::Variables variables{"x", "y", "z"};
+    const az::Program program = az::compile(*az::parse_expression("x*y - z", variables));
+    const std::vector<std::byte> bytes = az::save_program(program);
+    const auto view = az::ProgramView::load(bytes);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(view->variables(), 3);
+    const double values[] = {2, 3, 4};
+    EXPECT_EQ(view->evaluate(values), 2.0);
+}
+
+TEST(SerializationTest, RejectsMalformedInput) {
+    const std::vector<std::byte> valid = az::save_program(compiled("sqrt(x) * 3"));
+    ASSERT_TRUE(az::ProgramView::load(valid));
+
+    EXPECT_FALSE(az::ProgramView::load({}));
+    EXPECT_FALSE(az::ProgramView::load(std::span(valid).first(valid.size() - 1)));
+
+    auto corrupt = [&](const std::size_t offset, const std::byte value) {
+        std::vector<std::byte> bytes = valid;
+        bytes[offset] = value;
+        return az::ProgramView::load(bytes).has_value();
+    };
+    EXPECT_FALSE(corrupt(0, std::byte{'B'}));
+    EXPECT_FALSE(corrupt(4, std::byte{2}));
+    EXPECT_FALSE(corrupt(12, std::byte{0}));
+    // more registers than instructions, which would make evaluate_batch allocate gigabytes
+    EXPECT_FALSE(corrupt(14, std::byte{0x10}));
+    std::vector<std::byte> identity = az::save_program(compiled("x"));
+    identity[12] = std::byte{0};
+    identity[14] = std::byte{0x10};
+    EXPECT_FALSE(az::ProgramView::load(identity));
+    // kind of the first instruction
+    EXPECT_FALSE(corrupt(24, std::byte{200}));
+    // last instruction reads a register that is never written
+    const std::size_t last = valid.size() - sizeof(double) - 16;
+    EXPECT_FALSE(corrupt(last + 8, std::byte{0x7f}));
+    // constant index out of the pool
+    std::vector<std::byte> bytes = valid;
+    for (std::size_t i = 24; i < last; i += 16) {
+        if (bytes[i] == static_cast<std::byte>(az::Kind::Number)) bytes[i + 8] = std::byte{5};
+    }
+    EXPECT_FALSE(az::ProgramView::load(bytes));
+}
+
+TEST(SerializationTest, CatalogFromMappedFile) {
+    std::vector<az::Program> programs;
+    for (int i = 0; i < 50; ++i) {
+        programs.push_back(compiled(std::to_string(i) + "*x + sin(x)"));
+    }
+    const std::string path = testing::TempDir() + "az_serialization_test.bin";
+    {
+        const std::vector<std::byte> bytes = az::save_catalog(programs);
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+    {
+        const az::MappedFile file(path);
+        ASSERT_TRUE(file);
+        const auto catalog = az::CatalogView::load(file.bytes());
+        ASSERT_TRUE(catalog);
+        ASSERT_EQ(catalog->size(), programs.size());
+        for (std::size_t i = 0; i < programs.size(); ++i) {
+            EXPECT_EQ((*catalog)[i].evaluate(0.5), programs[i].evaluate(0.5)) << i;
+        }
+
+        std::vector<std::byte> truncated(file.bytes().begin(), file.bytes().end() - 8);
+        EXPECT_FALSE(az::CatalogView::load(truncated));
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,42 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/simplify.hpp>
+#include <gtest/gtest.h>
+
+TEST(SimplifyTest, FoldsConstants) {
+    const auto result = az::simplify(az::parse_expression("6/3*(x+1)"));
+    ASSERT_TRUE(result.expression);
+    EXPECT_EQ(result.nodes_before, 7);
+    EXPECT_EQ(result.nodes_after, 5);
+    EXPECT_EQ(result.removed(), 2);
+    EXPECT_DOUBLE_EQ(result.expression->evaluate(2), 6.0);
+}
+
+TEST(SimplifyTest, RemovesIdentities) {
+    const auto result = az::simplify(az::parse_expression("2*3*sin(x)*1+0"));
+    ASSERT_TRUE(result.expression);
+    EXPECT_EQ(result.nodes_before, 10);
+    EXPECT_EQ(result.nodes_after, 4);
+    EXPECT_EQ(result.expression->kind(), az::Kind::Mul);
+    EXPECT_DOUBLE_EQ(result.expression->evaluate(0.5), 6 * std::sin(0.5));
+
+    EXPECT_EQ(az::simplify(az::parse_expression("--x")).expression->kind(), az::Kind::X);
+    EXPECT_EQ(az::simplify(az::parse_expression("x^1")).expression->kind(), az::Kind::X);
+    EXPECT_EQ(az::simplify(az::parse_expression("1*x/1-0")).expression->kind(), az::Kind::X);
+}
+
+TEST(SimplifyTest, CanonicalOrder) {
+    const auto a = az::simplify(az::parse_expression("2*sin(x)+x")).expression;
+    const auto b = az::simplify(az::parse_expression("x+sin(x)*2")).expression;
+    EXPECT_EQ(az::detail::compare(*a, *b), 0);
+}
+
+TEST(SimplifyTest, KeepsOutOfDomain) {
+    const auto division = az::simplify(az::parse_expression("1/0+x")).expression;
+    ASSERT_EQ(az::count_nodes(*division), 3);
+    EXPECT_TRUE(std::isnan(division->evaluate(1)));
+    const auto root = az::simplify(az::parse_expression("sqrt(-1)")).expression;
+    ASSERT_EQ(root->kind(), az::Kind::Number);
+    EXPECT_TRUE(std::isnan(root->evaluate(1)));
+    const auto zero = az::simplify(az::parse_expression("ln(x)*0")).expression;
+    EXPECT_TRUE(std::isnan(zero->evaluate(-1)));
+}
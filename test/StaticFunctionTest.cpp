@@ -0,0 +1,49 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/static_function.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace {
+    template<az::FixedString S>
+    void expect_same_as_runtime() {
+        const auto tree = az::parse_expression(std::string(S.view()));
+        ASSERT_TRUE(tree) << S.view();
+        for (const double x : {-10.0, -2.0, -1.0, -0.5, 0.0, 0.5, 1.0, 2.0, 3.0, 100.0}) {
+            const double expected = tree->evaluate(x);
+            const double actual = az::static_function<S>::evaluate(x);
+            if (std::isnan(expected)) {
+                EXPECT_TRUE(std::isnan(actual)) << S.view() << " at " << x;
+            } else {
+                EXPECT_EQ(actual, expected) << S.view() << " at " << x;
+            }
+        }
+    }
+}
+
+TEST(StaticFunctionTest, Arithmetic) {
+    constexpr az::static_function<"6/3*(x+1)"> f;
+    EXPECT_EQ(f(2), 6.0);
+    static_assert(decltype(f)::size() == 7);
+    expect_same_as_runtime<"6/3*(x+1)">();
+    expect_same_as_runtime<" 2 ^ 3 ^ x - -x*4 / (x - 1) ">();
+    expect_same_as_runtime<"-x^2 + 0.1 + 12.375*x">();
+}
+
+TEST(StaticFunctionTest, Functions) {
+    expect_same_as_runtime<"sin(x)*cos(x) + tan(x) - cot(x)">();
+    expect_same_as_runtime<"sqrt(x) + cbrt(x) + ln(x) + lg(x) + log(x)">();
+    expect_same_as_runtime<"arcsin(x) + arccos(x/4) + arctan(x)">();
+}
+
+TEST(StaticFunctionTest, DomainIsSameAsRuntime) {
+    expect_same_as_runtime<"1/(x-1)">();
+    expect_same_as_runtime<"ln(x-1) * 0">();
+    EXPECT_TRUE(std::isnan(az::static_function<"sqrt(x)">::evaluate(-1)));
+}
+
+TEST(StaticFunctionTest, NumbersMatchRuntimeConversion) {
+    EXPECT_EQ(az::static_function<"0.1">::evaluate(0), 0.1);
+    EXPECT_EQ(az::static_function<"3.14159265358979">::evaluate(0), 3.14159265358979);
+    EXPECT_EQ(az::static_function<"2.50000000000000000000000000">::evaluate(0), 2.5);
+    EXPECT_EQ(az::static_function<"9007199254740992">::evaluate(0), 9007199254740992.0);
+}
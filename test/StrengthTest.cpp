@@ -0,0 +1,119 @@
+#include <az_math/function_parser.hpp>
+#include <az_math/program.hpp>
+#include <az_math/strength.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    constexpr double not_a_number = std::numeric_limits<double>::quiet_NaN();
+
+    bool contains(const az::Expression& e, const az::Kind kind) {
+        if (e.kind() == kind) {
+            return true;
+        }
+        const auto [l, r] = az::children(e);
+        return (l && contains(*l, kind)) || (r && contains(*r, kind));
+    }
+
+    void expectSame(const double expected, const double actual, const double x) {
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(actual)) << x;
+        } else {
+            EXPECT_EQ(actual, expected) << x;
+            EXPECT_EQ(std::signbit(actual), std::signbit(expected)) << x;
+        }
+    }
+}
+
+TEST(StrengthTest, IntegerPowersBecomeMultiplications) {
+    const az::StrengthOptions options{.polynomials = az::PolynomialScheme::None};
+    const auto original = az::parse_expression("sin(x)^2 + cos(x)^8 + x^40");
+    const auto reduced = az::reduce_strength(original, options).expression;
+    // x^40 is above max_exponent.
+    const auto [sum, big] = az::children(*reduced);
+    EXPECT_FALSE(contains(*sum, az::Kind::Pow));
+    EXPECT_EQ(big->kind(), az::Kind::Pow);
+    // sin(x)^2 = s*s replaces two nodes with one, cos(x)^8 = ((c*c)^2)^2 two with three.
+    EXPECT_EQ(az::count_nodes(*reduced), az::count_nodes(*original));
+
+    const auto square = az::reduce_strength(az::parse_expression("x^2"), options).expression;
+    for (const double x : {0.0, -0.0, 1.5, -3.25, 1e200, -1e-200, infinity, -infinity, not_a_number}) {
+        expectSame(std::pow(x, 2.0), square->evaluate(x), x);
+    }
+    const auto cube = az::reduce_strength(az::parse_expression("x^3"), options).expression;
+    for (const double x : {0.0, -0.0, -2.0, 1e200, infinity, -infinity, not_a_number}) {
+        expectSame(std::pow(x, 3.0), cube->evaluate(x), x);
+    }
+    EXPECT_NEAR(cube->evaluate(1.1), std::pow(1.1, 3.0), 1e-15);
+}
+
+TEST(StrengthTest, HalfPowerBecomesSqrt) {
+    const auto reduced = az::reduce_strength(az::parse_expression("(x+1)^0.5")).expression;
+    EXPECT_EQ(reduced->kind(), az::Kind::Sqrt);
+    for (const double x : {3.0, 0.0, -5.0, infinity, not_a_number}) {
+        expectSame(az::Pow::apply(x + 1, 0.5), reduced->evaluate(x), x);
+    }
+    const az::StrengthOptions keep{.sqrt = false};
+    EXPECT_EQ(az::reduce_strength(az::parse_expression("x^0.5"), keep).expression->kind(), az::Kind::Pow);
+}
+
+TEST(StrengthTest, PolynomialInHornerForm) {
+    const auto original = az::parse_expression("3*x^4 + 2*x^3 - x + 7");
+    const auto reduced = az::reduce_strength(original).expression;
+    EXPECT_FALSE(contains(*reduced, az::Kind::Pow));
+    // ((3x + 2)x^2 - 1)x + 7
+    EXPECT_EQ(az::count_nodes(*reduced), 12);
+    for (const double x : {0.0, 1.0, -2.0, 0.5, 10.0}) {
+        EXPECT_DOUBLE_EQ(reduced->evaluate(x), original->evaluate(x)) << x;
+    }
+    EXPECT_TRUE(std::isnan(reduced->evaluate(not_a_number)));
+}
+
+TEST(StrengthTest, PolynomialInEstrinForm) {
+    const az::StrengthOptions options{.polynomials = az::PolynomialScheme::Estrin};
+    const auto original = az::parse_expression("1 + 2*x + 3*x^2 + 4*x^3 + 5*x^4 + 6*x^5 + 7*x^6 + 8*x^7");
+    const auto reduced = az::reduce_strength(original, options).expression;
+    EXPECT_FALSE(contains(*reduced, az::Kind::Pow));
+    const az::Program program = az::compile(*reduced);
+    for (const double x : {0.0, 1.0, -2.0, 0.3}) {
+        EXPECT_DOUBLE_EQ(program.evaluate(x), original->evaluate(x)) << x;
+    }
+}
+
+TEST(StrengthTest, OnlyPolynomialSubtrees) {
+    const auto original = az::parse_expression("sin(x^2 + 2*x + 1) * (x - 1)^2 + ln(x)");
+    const auto reduced = az::reduce_strength(original).expression;
+    EXPECT_FALSE(contains(*reduced, az::Kind::Pow));
+    EXPECT_TRUE(contains(*reduced, az::Kind::Sin));
+    EXPECT_TRUE(contains(*reduced, az::Kind::Ln));
+    for (const double x : {0.5, 2.0, 3.0}) {
+        EXPECT_DOUBLE_EQ(reduced->evaluate(x), original->evaluate(x)) << x;
+    }
+
+    const az::Variables variables{"x", "y"};
+    const auto mixed = az::parse_expression("x^2 + y^2", variables);
+    const auto kept = az::reduce_strength(mixed).expression;
+    const double values[] = {3, 4};
+    EXPECT_EQ(kept->evaluate(values), 25.0);
+}
+
+TEST(StrengthTest, FactoredFormsAreNotExpanded) {
+    const auto power = az::parse_expression("(x - 1)^10");
+    const auto reduced = az::reduce_strength(power).expression;
+    EXPECT_FALSE(contains(*reduced, az::Kind::Pow));
+    EXPECT_NEAR(reduced->evaluate(1.01), 1e-20, 1e-33);
+    const auto even = az::reduce_strength(az::parse_expression("(x - 1)^32")).expression;
+    EXPECT_GT(even->evaluate(1.1), 0.0);
+    EXPECT_NEAR(even->evaluate(1.1), std::pow(0.1, 32), 1e-44);
+
+    const auto product = az::parse_expression("(x-1)*(x-1)*(x-1)*(x-1)*(x-1)*(x-1)*(x-1)*(x-1)");
+    const auto kept = az::reduce_strength(product).expression;
+    EXPECT_NEAR(kept->evaluate(1.001), 1e-24, 1e-36);
+
+    // Sums of monomials are still collected.
+    const auto sum = az::reduce_strength(az::parse_expression("2*x^3 + x*x - (x - 1) + 4")).expression;
+    EXPECT_FALSE(contains(*sum, az::Kind::Minus));
+    EXPECT_EQ(sum->evaluate(2.0), 23.0);
+}
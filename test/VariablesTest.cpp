@@ -0,0 +1,82 @@
+#include <az_math/cse.hpp>
+#include <az_math/derivative.hpp>
+#include <az_math/function_parser.hpp>
+#include <az_math/jit.hpp>
+#include <az_math/program.hpp>
+#include <az_math/simplify.hpp>
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+TEST(VariablesTest, NamesResolveToSlots) {
+    const az::Variables variables{"a", "x", "b"};
+    const auto tree = az::parse_expression("a*x^2 + b*x", variables);
+    ASSERT_TRUE(tree);
+    const std::array values{2.0, 3.0, 5.0};
+    EXPECT_DOUBLE_EQ(tree->evaluate(values), 2 * 9 + 5 * 3);
+
+    const az::Program program = az::compile(*tree);
+    EXPECT_EQ(program.variables(), 3);
+    EXPECT_DOUBLE_EQ(program.evaluate(values), 33.0);
+}
+
+TEST(VariablesTest, UndeclaredNameIsError) {
+    const az::Variables variables{"a", "b"};
+    EXPECT_FALSE(az::parse_expression("a + c", variables));
+    EXPECT_FALSE(az::parse_expression("x", variables));
+    EXPECT_TRUE(az::parse_expression("sin(a) + b_1", az::Variables{"a", "b_1"}));
+}
+
+TEST(VariablesTest, StructOfArraysBatch) {
+    const auto tree = az::parse_expression("sqrt(u*u + v*v) / w", az::Variables{"u", "v", "w"});
+    ASSERT_TRUE(tree);
+    const az::Program program = az::compile(*tree);
+
+    constexpr std::size_t n = 1000;
+    std::vector<double> u(n), v(n), w(n), out(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        u[i] = static_cast<double>(i) * 0.5;
+        v[i] = 3.0 - static_cast<double>(i);
+        w[i] = static_cast<double>(i % 7);
+    }
+    const std::array<std::span<const double>, 3> columns{u, v, w};
+    program.evaluate_batch(columns, out);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::array values{u[i], v[i], w[i]};
+        const double expected = tree->evaluate(values);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(out[i])) << i;
+        } else {
+            EXPECT_DOUBLE_EQ(out[i], expected) << i;
+        }
+    }
+}
+
+TEST(VariablesTest, SingleVariableMatchesX) {
+    const auto x = az::parse_expression("x^2 + 1");
+    const auto t = az::parse_expression("t^2 + 1", az::Variables{"t"});
+    ASSERT_TRUE(t);
+    EXPECT_EQ(az::compile(*t).evaluate(3), x->evaluate(3));
+    EXPECT_EQ(t->evaluate(3), 10.0);
+
+    const az::JitFunction function(az::compile(*t));
+    EXPECT_EQ(function.evaluate(3), 10.0);
+}
+
+TEST(VariablesTest, DistinctVariablesAreNotMerged) {
+    const auto tree = az::parse_expression("sin(a) + sin(b)", az::Variables{"a", "b"});
+    const auto result = az::eliminate_common_subexpressions(az::simplify(tree).expression);
+    EXPECT_EQ(result.nodes_after, result.nodes_before);
+}
+
+TEST(VariablesTest, PartialDerivatives) {
+    const az::Variables variables{"a", "x"};
+    const auto tree = az::parse_expression("a*x^2", variables);
+    const std::array values{3.0, 2.0};
+    EXPECT_DOUBLE_EQ(az::differentiate(*tree, 0)->evaluate(values), 4.0);
+    EXPECT_DOUBLE_EQ(az::differentiate(*tree, 1)->evaluate(values), 12.0);
+
+    const az::Program program = az::compile(*tree);
+    EXPECT_DOUBLE_EQ(az::evaluate_with_derivative(program, values, 1).derivative, 12.0);
+}